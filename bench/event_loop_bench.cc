@@ -0,0 +1,198 @@
+/*
+    ### Event loop benchmark ###
+
+    Opens many HTTP/2 connections over loopback TCP and drives each side with
+    one EventLoop on one thread. The server runs in a forked child, so each
+    process needs a descriptor per connection only.
+
+        handshake   connect, both prefaces and the SETTINGS exchange of every connection
+        ping        rounds in which every client sends a PING and waits for the ACK
+
+    It prints the connection setup rate, the PING round trips per second and
+    the client's resident memory per connection.
+
+    Build with "make bench" and run "bench/event_loop_bench [connections] [rounds]",
+    10000 connections and 20 rounds by default. The descriptor limit is raised
+    to its hard limit; fewer connections are opened if that is not enough.
+*/
+#include <stdint.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "../src/event_loop.h"
+
+using namespace lhttp2;
+
+#define CONNECT_BATCH 256           // connects in flight before the loop takes a turn
+#define TIMEOUT_SECONDS 60
+
+static double Now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static long ResidentKB() {
+    char line[256];
+    long kb = 0;
+
+    FILE* fp = fopen("/proc/self/status", "r");
+    if(fp == nullptr) return 0;
+
+    while(fgets(line, sizeof(line), fp) != nullptr) {
+        if(strncmp(line, "VmRSS:", 6) == 0) kb = atol(line + 6);
+    }
+
+    fclose(fp);
+    return kb;
+}
+
+// Answers every PING.
+class EchoHandler : public ConnectionHandler {
+public:
+    void OnFrame(Connection& connection, Frame* frame) override {
+        if(frame->type() != Frame::TYPE_PING_FRAME || frame->has_flags(Frame::FLAG_ACK)) return;
+
+        PingFrame ack(((PingFrame*)frame)->opaque_data());
+        ack.set_ack_flag();
+        connection.SendFrame(0, &ack);
+    }
+};
+
+class ClientHandler : public ConnectionHandler {
+public:
+    void OnOpen(Connection& connection) override {
+        open.push_back(&connection);
+    }
+
+    void OnFrame(Connection& connection, Frame* frame) override {
+        if(frame->type() == Frame::TYPE_PING_FRAME && frame->has_flags(Frame::FLAG_ACK)) acks++;
+    }
+
+    void OnClose(Connection& connection) override {
+        for(size_t i = 0; i < open.size(); i++) {
+            if(open[i] != &connection) continue;
+            open[i] = open.back();
+            open.pop_back();
+            break;
+        }
+        closed++;
+    }
+
+    std::vector<Connection*> open;
+    uint64_t acks = 0;
+    uint64_t closed = 0;
+};
+
+static void RunServer(int listen_fd) {
+    EchoHandler handler;
+    EventLoop loop(&handler);
+
+    if(loop.Ok() == false || loop.Listen(listen_fd) == false) exit(1);
+    loop.Run();
+    exit(0);
+}
+
+int main(int argc, char* argv[]) {
+    size_t connections = (argc > 1) ? atol(argv[1]) : 10000;
+    int rounds = (argc > 2) ? atoi(argv[2]) : 20;
+    struct rlimit limit;
+    struct sockaddr_in addr = {};
+    socklen_t addr_len = sizeof(addr);
+
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    if(limit.rlim_cur != RLIM_INFINITY && connections + 64 > limit.rlim_cur) {
+        connections = limit.rlim_cur - 64;
+        fprintf(stderr, "descriptor limit %lu, running %zu connections\n", (unsigned long)limit.rlim_cur, connections);
+    }
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, SOMAXCONN) < 0) {
+        perror("listen");
+        return 1;
+    }
+    getsockname(listen_fd, (struct sockaddr*)&addr, &addr_len);
+
+    pid_t server = fork();
+    if(server == 0) RunServer(listen_fd);
+    close(listen_fd);
+
+    ClientHandler handler;
+    EventLoop loop(&handler);
+    long rss_before = ResidentKB();
+    double start = Now(), deadline = start + TIMEOUT_SECONDS;
+    size_t started = 0;
+
+    // Handshakes, a batch of connects at a time so the accept backlog keeps up.
+    while(handler.open.size() + handler.closed < connections && Now() < deadline) {
+        while(started < connections && started - handler.open.size() - handler.closed < CONNECT_BATCH) {
+            int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+            if(fd < 0) {
+                perror("socket");
+                connections = started;
+                break;
+            }
+
+            if(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+                perror("connect");
+                close(fd);
+                connections = started;
+                break;
+            }
+
+            if(loop.Add(fd, Connection::ENDPOINT_CLIENT) == nullptr) handler.closed++;
+            started++;
+        }
+
+        loop.RunOnce(10);
+    }
+
+    double handshake = Now() - start;
+    long rss_after = ResidentKB();
+    size_t open = handler.open.size();
+
+    printf("%-12s %10s %12s %14s\n", "benchmark", "conns", "seconds", "per second");
+    printf("%-12s %10zu %12.3f %14.0f\n", "handshake", open, handshake, open / handshake);
+
+    // PING round trips over every connection at once.
+    uint64_t expected = 0;
+    start = Now();
+    deadline = start + TIMEOUT_SECONDS;
+
+    for(int round = 0; round < rounds && Now() < deadline; round++) {
+        for(size_t i = 0; i < handler.open.size(); i++) {
+            PingFrame ping(round);
+            handler.open[i]->SendFrame(0, &ping);
+            handler.open[i]->Flush();
+        }
+        expected = expected + handler.open.size();
+
+        while(handler.acks < expected && Now() < deadline) loop.RunOnce(10);
+    }
+
+    double elapsed = Now() - start;
+    printf("%-12s %10zu %12.3f %14.0f\n", "ping", open, elapsed, handler.acks / elapsed);
+    printf("client memory %.1f KB per connection, %lu closed\n",
+           open > 0 ? (double)(rss_after - rss_before) / open : 0.0, (unsigned long)handler.closed);
+
+    kill(server, SIGTERM);
+    waitpid(server, nullptr, 0);
+
+    return (handler.acks == expected && open == connections) ? 0 : 1;
+}
@@ -0,0 +1,442 @@
+/*
+    ### HPACK benchmark ###
+
+    Self-contained microbenchmarks for the header compression path:
+    Table::Encode, Table::Decode (views and HeaderFieldRepresentation),
+    Huffman::Encode/Decode and integer coding, each run against three
+    synthetic corpora shaped after recorded traffic.
+
+        browser     page load of one HTML document and its subresources
+        grpc        unary calls, request and response blocks interleaved
+        proxy       forwarded requests carrying large cookies
+
+    For every run it prints the time per header, the throughput over the raw
+    name and value octets, heap allocations per header block and, for the
+    table benchmarks, the ratio of encoded to raw octets.
+
+    Build with "make bench" and run "bench/hpack_bench [filter] [seconds]".
+    Only benchmarks whose name contains filter are run, every one of them for
+    at least seconds (default 0.5).
+*/
+#include <stdint.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "../src/hpack/hpack.h"
+#include "../src/hpack/huffman.h"
+
+using namespace hpack;
+
+/*
+    Allocation counting. On glibc the executable's malloc family overrides the
+    C library one, so every allocation of the library (and of operator new)
+    passes through here.
+*/
+static uint64_t allocations = 0;
+
+#if defined(__GLIBC__)
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* p, size_t size);
+    void __libc_free(void* p);
+
+    void* malloc(size_t size) {
+        allocations++;
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) {
+        allocations++;
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* p, size_t size) {
+        allocations++;
+        return __libc_realloc(p, size);
+    }
+
+    void free(void* p) {
+        __libc_free(p);
+    }
+}
+#define ALLOCATIONS_COUNTED true
+#else
+#define ALLOCATIONS_COUNTED false
+#endif
+
+typedef std::vector<HeaderFieldRepresentation> HeaderList;
+
+struct Corpus {
+    std::string name;
+    std::vector<HeaderList> blocks;
+    uint64_t headers = 0;
+    uint64_t raw_bytes = 0;
+};
+
+// Deterministic pseudo random numbers, so every run sees the same corpora.
+static uint32_t seed = 0x2545f491;
+
+static uint32_t Random() {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) & 0xffffff;
+}
+
+static std::string RandomToken(uint32_t len) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_";
+    std::string token;
+    for(uint32_t i = 0; i < len; i++) {
+        token.push_back(alphabet[Random() % (sizeof(alphabet) - 1)]);
+    }
+    return token;
+}
+
+static void Add(HeaderList& list, const std::string& name, const std::string& value) {
+    HeaderFieldRepresentation header;
+    header.Field().SetName(name);
+    header.Field().SetValue(value);
+    list.push_back(header);
+}
+
+static void AddBlock(Corpus& corpus, const HeaderList& list) {
+    corpus.blocks.push_back(list);
+    corpus.headers = corpus.headers + list.size();
+    for(size_t i = 0; i < list.size(); i++) {
+        corpus.raw_bytes = corpus.raw_bytes + list[i].Field().Name().length() + list[i].Field().Value().length();
+    }
+}
+
+static Corpus BrowserCorpus() {
+    static const char* assets[] = {
+        "/", "/static/css/main.css", "/static/js/runtime.js", "/static/js/vendor.js", "/static/js/app.js",
+        "/static/fonts/inter-regular.woff2", "/static/fonts/inter-bold.woff2", "/api/session", "/api/feed?page=1",
+        "/favicon.ico", "/manifest.json",
+    };
+    static const char* accepts[] = {
+        "text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8",
+        "text/css,*/*;q=0.1", "*/*", "*/*", "*/*", "*/*", "*/*", "application/json", "application/json",
+        "image/avif,image/webp,image/apng,image/*,*/*;q=0.8", "*/*",
+    };
+    Corpus corpus;
+    std::string cookie = "_ga=GA1.2." + RandomToken(20) + "; session=" + RandomToken(48) + "; theme=dark";
+
+    corpus.name = "browser";
+    for(int i = 0; i < 60; i++) {
+        HeaderList list;
+        int asset = (i < 11) ? i : 11 + Random() % 40;
+        std::string path = (asset < 11) ? assets[asset] : "/static/img/" + RandomToken(12) + ".webp";
+
+        Add(list, ":method", "GET");
+        Add(list, ":authority", "www.example.com");
+        Add(list, ":scheme", "https");
+        Add(list, ":path", path);
+        Add(list, "sec-ch-ua", "\"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"");
+        Add(list, "sec-ch-ua-mobile", "?0");
+        Add(list, "sec-ch-ua-platform", "\"Linux\"");
+        Add(list, "user-agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36");
+        Add(list, "accept", accepts[asset < 11 ? asset : 9]);
+        Add(list, "sec-fetch-site", i == 0 ? "none" : "same-origin");
+        Add(list, "sec-fetch-mode", i == 0 ? "navigate" : "no-cors");
+        Add(list, "sec-fetch-dest", i == 0 ? "document" : "image");
+        if(i > 0) Add(list, "referer", "https://www.example.com/");
+        Add(list, "accept-encoding", "gzip, deflate, br, zstd");
+        Add(list, "accept-language", "en-US,en;q=0.9");
+        Add(list, "cookie", cookie);
+        if(i == 0) Add(list, "upgrade-insecure-requests", "1");
+        AddBlock(corpus, list);
+    }
+    return corpus;
+}
+
+static Corpus GrpcCorpus() {
+    static const char* methods[] = {
+        "/inventory.v1.Inventory/GetItem", "/inventory.v1.Inventory/ListItems",
+        "/pricing.v2.Pricing/Quote", "/auth.v1.Tokens/Validate",
+    };
+    Corpus corpus;
+
+    corpus.name = "grpc";
+    for(int i = 0; i < 100; i++) {
+        HeaderList request, response;
+
+        Add(request, ":method", "POST");
+        Add(request, ":scheme", "http");
+        Add(request, ":path", methods[Random() % 4]);
+        Add(request, ":authority", "inventory.internal:8443");
+        Add(request, "content-type", "application/grpc");
+        Add(request, "user-agent", "grpc-go/1.63.2");
+        Add(request, "te", "trailers");
+        Add(request, "grpc-accept-encoding", "identity,deflate,gzip");
+        Add(request, "grpc-timeout", std::to_string(100 + Random() % 900) + "m");
+        Add(request, "x-request-id", RandomToken(32));
+        Add(request, "traceparent", "00-" + RandomToken(32) + "-" + RandomToken(16) + "-01");
+        AddBlock(corpus, request);
+
+        Add(response, ":status", "200");
+        Add(response, "content-type", "application/grpc");
+        Add(response, "grpc-encoding", "identity");
+        Add(response, "grpc-accept-encoding", "identity,deflate,gzip");
+        Add(response, "date", "Sat, 17 Oct 2026 10:" + std::to_string(10 + i % 50) + ":00 GMT");
+        AddBlock(corpus, response);
+    }
+    return corpus;
+}
+
+static Corpus ProxyCorpus() {
+    Corpus corpus;
+    std::vector<std::string> cookies;
+
+    // A few users with 1-4 KB of cookies each, as they arrive at a reverse proxy.
+    for(int i = 0; i < 8; i++) {
+        std::string cookie;
+        uint32_t count = 10 + Random() % 40;
+        for(uint32_t j = 0; j < count; j++) {
+            if(j > 0) cookie.append("; ");
+            cookie.append(RandomToken(4 + Random() % 8) + "=" + RandomToken(20 + Random() % 80));
+        }
+        cookies.push_back(cookie);
+    }
+
+    corpus.name = "proxy";
+    for(int i = 0; i < 80; i++) {
+        HeaderList list;
+        uint32_t user = Random() % cookies.size();
+
+        Add(list, ":method", (i % 5 == 0) ? "POST" : "GET");
+        Add(list, ":scheme", "https");
+        Add(list, ":authority", "shop.example.com");
+        Add(list, ":path", "/product/" + std::to_string(Random() % 100000) + "?ref=" + RandomToken(8));
+        Add(list, "user-agent", "Mozilla/5.0 (iPhone; CPU iPhone OS 17_4 like Mac OS X) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.4 Mobile/15E148 Safari/604.1");
+        Add(list, "accept", "*/*");
+        Add(list, "accept-encoding", "gzip, deflate, br");
+        Add(list, "cookie", cookies[user]);
+        Add(list, "x-forwarded-for", std::to_string(Random() % 256) + "." + std::to_string(Random() % 256) + ".10." + std::to_string(user));
+        Add(list, "x-forwarded-proto", "https");
+        Add(list, "via", "2 edge-proxy");
+        Add(list, "x-request-id", RandomToken(36));
+        AddBlock(corpus, list);
+    }
+    return corpus;
+}
+
+// Only fully indexed static fields, so encoding and decoding is almost all integer coding.
+static Corpus IntegerCorpus() {
+    static const char* fields[][2] = {
+        {":method", "GET"}, {":method", "POST"}, {":path", "/"}, {":scheme", "https"}, {":status", "200"},
+        {":status", "304"}, {":status", "404"}, {"accept-encoding", "gzip, deflate"},
+    };
+    Corpus corpus;
+
+    corpus.name = "integer";
+    for(int i = 0; i < 100; i++) {
+        HeaderList list;
+        for(int j = 0; j < 16; j++) {
+            Add(list, fields[Random() % 8][0], fields[Random() % 8][1]);
+        }
+        AddBlock(corpus, list);
+    }
+    return corpus;
+}
+
+struct Result {
+    uint64_t passes = 0;
+    double seconds = 0.0;
+    uint64_t allocations = 0;
+    uint64_t encoded_bytes = 0;     // per pass, 0 when it does not apply
+};
+
+static void Report(const char* bench, const Corpus& corpus, const Result& result) {
+    double headers = (double)corpus.headers * result.passes;
+    double blocks = (double)corpus.blocks.size() * result.passes;
+
+    printf("%-16s %-8s %10.1f %10.1f ", bench, corpus.name.c_str(),
+        result.seconds * 1e9 / headers, (double)corpus.raw_bytes * result.passes / result.seconds / 1e6);
+    if(ALLOCATIONS_COUNTED) printf("%12.2f ", result.allocations / blocks);
+    else printf("%12s ", "n/a");
+    if(result.encoded_bytes > 0) printf("%8.3f\n", (double)result.encoded_bytes / corpus.raw_bytes);
+    else printf("%8s\n", "-");
+}
+
+/*
+    Runs pass() until min_seconds have elapsed. Setup which has to be repeated
+    for every pass, such as a fresh Table, is done in prepare() outside of the
+    measured time and allocation count.
+*/
+template <typename Prepare, typename Pass>
+static Result Run(double min_seconds, Prepare prepare, Pass pass) {
+    Result result;
+    std::chrono::steady_clock::duration elapsed(0);
+
+    // Warm up pools and caches.
+    prepare();
+    pass();
+
+    while(std::chrono::duration<double>(elapsed).count() < min_seconds) {
+        prepare();
+
+        uint64_t allocations_before = allocations;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        pass();
+        elapsed = elapsed + (std::chrono::steady_clock::now() - start);
+        result.allocations = result.allocations + (allocations - allocations_before);
+
+        result.passes++;
+    }
+
+    result.seconds = std::chrono::duration<double>(elapsed).count();
+    return result;
+}
+
+static void BenchEncode(const Corpus& corpus, double min_seconds) {
+    Table* table = nullptr;
+    Buffer out;
+    uint64_t encoded_bytes = 0;
+
+    Result result = Run(min_seconds, [&]() {
+        delete table;
+        table = new Table();
+    }, [&]() {
+        encoded_bytes = 0;
+        for(size_t i = 0; i < corpus.blocks.size(); i++) {
+            table->Encode(out, corpus.blocks[i]);
+            encoded_bytes = encoded_bytes + out.Length();
+        }
+    });
+    delete table;
+
+    result.encoded_bytes = encoded_bytes;
+    Report("encode", corpus, result);
+}
+
+// Encodes the corpus once on a fresh table, as one connection would send it.
+static std::vector<Buffer> EncodeCorpus(const Corpus& corpus) {
+    std::vector<Buffer> encoded(corpus.blocks.size());
+    Table table;
+
+    for(size_t i = 0; i < corpus.blocks.size(); i++) {
+        table.Encode(encoded[i], corpus.blocks[i]);
+    }
+    return encoded;
+}
+
+static void BenchDecodeView(const Corpus& corpus, double min_seconds) {
+    std::vector<Buffer> encoded = EncodeCorpus(corpus);
+    Table* table = nullptr;
+    HeaderBlock block;
+
+    Result result = Run(min_seconds, [&]() {
+        delete table;
+        table = new Table();
+    }, [&]() {
+        for(size_t i = 0; i < encoded.size(); i++) {
+            if(table->Decode(block, encoded[i].Address(), encoded[i].Length()) == false) {
+                fprintf(stderr, "decode failed\n");
+                exit(1);
+            }
+        }
+    });
+    delete table;
+
+    Report("decode-view", corpus, result);
+}
+
+static void BenchDecodeList(const Corpus& corpus, double min_seconds) {
+    std::vector<Buffer> encoded = EncodeCorpus(corpus);
+    Table* table = nullptr;
+    HeaderList list;
+
+    Result result = Run(min_seconds, [&]() {
+        delete table;
+        table = new Table();
+    }, [&]() {
+        for(size_t i = 0; i < encoded.size(); i++) {
+            list.clear();
+            if(table->Decode(list, encoded[i]) == false) {
+                fprintf(stderr, "decode failed\n");
+                exit(1);
+            }
+        }
+    });
+    delete table;
+
+    Report("decode-list", corpus, result);
+}
+
+static void BenchHuffmanEncode(const Corpus& corpus, double min_seconds) {
+    std::vector<char> out(1 << 16);
+    uint64_t encoded_bytes = 0;
+
+    Result result = Run(min_seconds, []() {}, [&]() {
+        encoded_bytes = 0;
+        for(size_t i = 0; i < corpus.blocks.size(); i++) {
+            for(size_t j = 0; j < corpus.blocks[i].size(); j++) {
+                const HeaderField& field = corpus.blocks[i][j].Field();
+                encoded_bytes = encoded_bytes + Huffman::Encode(&out[0], field.Name().data(), field.Name().length());
+                encoded_bytes = encoded_bytes + Huffman::Encode(&out[0], field.Value().data(), field.Value().length());
+            }
+        }
+    });
+
+    result.encoded_bytes = encoded_bytes;
+    Report("huffman-encode", corpus, result);
+}
+
+static void BenchHuffmanDecode(const Corpus& corpus, double min_seconds) {
+    std::vector<std::string> encoded;
+    std::vector<char> out(1 << 17);
+    uint32_t out_len;
+
+    for(size_t i = 0; i < corpus.blocks.size(); i++) {
+        for(size_t j = 0; j < corpus.blocks[i].size(); j++) {
+            const HeaderField& field = corpus.blocks[i][j].Field();
+            const std::string* strings[] = {&field.Name(), &field.Value()};
+            for(int k = 0; k < 2; k++) {
+                std::string code(Huffman::EncodedLength(strings[k]->data(), strings[k]->length()), '\0');
+                if(code.length() > 0) Huffman::Encode(&code[0], strings[k]->data(), strings[k]->length());
+                encoded.push_back(code);
+            }
+        }
+    }
+
+    Result result = Run(min_seconds, []() {}, [&]() {
+        for(size_t i = 0; i < encoded.size(); i++) {
+            if(Huffman::Decode(&out[0], out_len, encoded[i].data(), encoded[i].length()) == false) {
+                fprintf(stderr, "huffman decode failed\n");
+                exit(1);
+            }
+        }
+    });
+
+    Report("huffman-decode", corpus, result);
+}
+
+int main(int argc, char* argv[]) {
+    const char* filter = (argc > 1) ? argv[1] : "";
+    double min_seconds = (argc > 2) ? atof(argv[2]) : 0.5;
+
+    std::vector<Corpus> corpora;
+    corpora.push_back(BrowserCorpus());
+    corpora.push_back(GrpcCorpus());
+    corpora.push_back(ProxyCorpus());
+    Corpus integers = IntegerCorpus();
+
+    printf("%-16s %-8s %10s %10s %12s %8s\n", "benchmark", "corpus", "ns/header", "MB/s", "allocs/block", "ratio");
+
+    for(size_t i = 0; i < corpora.size(); i++) {
+        const Corpus& corpus = corpora[i];
+        if(strstr(("encode " + corpus.name).c_str(), filter) != nullptr) BenchEncode(corpus, min_seconds);
+        if(strstr(("decode-view " + corpus.name).c_str(), filter) != nullptr) BenchDecodeView(corpus, min_seconds);
+        if(strstr(("decode-list " + corpus.name).c_str(), filter) != nullptr) BenchDecodeList(corpus, min_seconds);
+        if(strstr(("huffman-encode " + corpus.name).c_str(), filter) != nullptr) BenchHuffmanEncode(corpus, min_seconds);
+        if(strstr(("huffman-decode " + corpus.name).c_str(), filter) != nullptr) BenchHuffmanDecode(corpus, min_seconds);
+    }
+
+    if(strstr("encode integer", filter) != nullptr) BenchEncode(integers, min_seconds);
+    if(strstr("decode-view integer", filter) != nullptr) BenchDecodeView(integers, min_seconds);
+
+    return 0;
+}
@@ -4,36 +4,50 @@
 #include <cstring>
 
 #include "buffer.h"
+#include "byte_cursor.h"
 
 Buffer::Buffer() {
-    len = 0;
-    max_len = 8;
-    buffer = (char *)malloc(sizeof(char) * max_len);
-    memset(buffer, 0, max_len);
 }
 
 Buffer::Buffer(const unsigned int buff_len) {
     UpdateBufferSize(buff_len);
-    memset(buffer, 0, max_len);
-    len = 0;
 }
 
 Buffer::Buffer(const char* str) {
-    UpdateBufferSize(strlen(str));
-    memset(buffer, 0, max_len);
-    strncpy(buffer, str, strlen(str));
-    len = strlen(str);
+    unsigned int str_len = strlen(str);
+    UpdateBufferSize(str_len);
+    memcpy(buffer, str, str_len);
+    len = str_len;
 }
 
 Buffer::Buffer(const char* str, const unsigned int str_len) {
     UpdateBufferSize(str_len);
-    memset(buffer, 0, max_len);
     memcpy(buffer, str, str_len);
     len = str_len;
 }
 
+Buffer::Buffer(const struct Buffer& a) {
+    UpdateBufferSize(a.len);
+    memcpy(buffer, a.buffer, a.len);
+    len = a.len;
+}
+
+Buffer::Buffer(struct Buffer&& a) {
+    if(a.IsInline()) {
+        memcpy(buffer, a.buffer, a.len);
+    }
+    else {
+        buffer = a.buffer;
+        max_len = a.max_len;
+        a.buffer = a.inline_buffer;
+        a.max_len = BUFFER_INLINE_SIZE;
+    }
+    len = a.len;
+    a.len = 0;
+}
+
 Buffer::~Buffer() {
-    if(buffer != nullptr) free(buffer);
+    if(IsInline() == false) free(buffer);
 }
 
 void Buffer::Append(const struct Buffer& a) {
@@ -64,19 +78,44 @@ void Buffer::Copy(const char ch, const unsigned int at) {
     Set(ch, at);
 }
 
+void Buffer::Reserve(const unsigned int capacity) {
+    UpdateBufferSize(capacity);
+}
+
+void Buffer::ShrinkToFit() {
+    if(IsInline()) return;
+
+    if(len <= BUFFER_INLINE_SIZE) {
+        char* heap = buffer;
+        memcpy(inline_buffer, heap, len);
+        free(heap);
+        buffer = inline_buffer;
+        max_len = BUFFER_INLINE_SIZE;
+    }
+    else if(len < max_len) {
+        buffer = (char *)realloc(buffer, sizeof(char) * len);
+        max_len = len;
+    }
+}
+
 void Buffer::Resize(const unsigned int buff_len) {
     UpdateBufferSize(buff_len);
+    if(buff_len > len) memset(buffer + len, 0, buff_len - len);
     len = buff_len;
 }
 
 void Buffer::Clear() {
-    Resize(0);
+    len = 0;
 }
 
 unsigned int Buffer::Length() const {
     return len;
 }
 
+unsigned int Buffer::Capacity() const {
+    return max_len;
+}
+
 const char* Buffer::Address(const unsigned int idx) const {
     if(idx >= len) return nullptr;
     return buffer + idx;
@@ -92,22 +131,44 @@ void Buffer::Set(const char ch, const unsigned int idx) {
 }
 
 uint64_t Buffer::GetValue(const unsigned int bytes, const unsigned int idx) const {
-    if(bytes > 8) return 0;
+    if(bytes > 8 || idx + bytes > len) return 0;
+
+    switch(bytes) {
+        case 1: return byte_order::Load<1>(buffer + idx);
+        case 2: return byte_order::Load<2>(buffer + idx);
+        case 3: return byte_order::Load<3>(buffer + idx);
+        case 4: return byte_order::Load<4>(buffer + idx);
+        case 8: return byte_order::Load<8>(buffer + idx);
+        default: break;
+    }
+
     uint64_t value = 0;
-    for(int i = 0; i < bytes; i++) {
-        value = (value << 8) | buffer[i + idx];
+    for(unsigned int i = 0; i < bytes; i++) {
+        value = (value << 8) | (uint8_t)buffer[i + idx];
     }
     return value;
 }
 
 bool Buffer::SetValue(const uint64_t value, const int bytes, const unsigned int idx) {
-    if(bytes > 8) return false;
+    if(bytes < 0 || bytes > 8) return false;
     if(max_len < idx + bytes) UpdateBufferSize(idx + bytes);
-    int offset = 8 * bytes;
-    for(int i = 0; i < bytes; i++) {
-        offset = offset - 8;
-        buffer[i + idx] = (uint8_t)(value >> offset);
+
+    switch(bytes) {
+        case 1: byte_order::Store<1>(buffer + idx, value); break;
+        case 2: byte_order::Store<2>(buffer + idx, value); break;
+        case 3: byte_order::Store<3>(buffer + idx, value); break;
+        case 4: byte_order::Store<4>(buffer + idx, value); break;
+        case 8: byte_order::Store<8>(buffer + idx, value); break;
+        default: {
+            int offset = 8 * bytes;
+            for(int i = 0; i < bytes; i++) {
+                offset = offset - 8;
+                buffer[i + idx] = (uint8_t)(value >> offset);
+            }
+            break;
+        }
     }
+
     if(len < idx + bytes) len = idx + bytes;
     return true;
 }
@@ -121,16 +182,38 @@ char& Buffer::operator[](const unsigned int i) {
 }
 
 struct Buffer& Buffer::operator=(const struct Buffer& a) {
+    if(this == &a) return *this;
     UpdateBufferSize(a.len);
     memcpy(buffer, a.buffer, a.len);
     len = a.len;
     return *this;
 }
 
+struct Buffer& Buffer::operator=(struct Buffer&& a) {
+    if(this == &a) return *this;
+
+    // Keep our own allocation when the source lives inline or fits anyway.
+    if(a.IsInline() || (IsInline() == false && a.len <= max_len)) {
+        UpdateBufferSize(a.len);
+        memcpy(buffer, a.buffer, a.len);
+    }
+    else {
+        if(IsInline() == false) free(buffer);
+        buffer = a.buffer;
+        max_len = a.max_len;
+        a.buffer = a.inline_buffer;
+        a.max_len = BUFFER_INLINE_SIZE;
+    }
+    len = a.len;
+    a.len = 0;
+    return *this;
+}
+
 struct Buffer& Buffer::operator=(const char* str) {
-    UpdateBufferSize(strlen(str));
-    memcpy(buffer, str, strlen(str));
-    len = strlen(str);
+    unsigned int str_len = strlen(str);
+    UpdateBufferSize(str_len);
+    memcpy(buffer, str, str_len);
+    len = str_len;
     return *this;
 }
 
@@ -177,11 +260,26 @@ struct Buffer& Buffer::operator+=(const char ch) {
 }
 
 void Buffer::UpdateBufferSize(const unsigned int min) {
-    max_len = 8;
-    while(max_len < min) {
-        max_len = max_len * 2;
+    if(min <= max_len) return;
+
+    unsigned int new_len = max_len;
+    while(new_len < min) {
+        new_len = new_len * 2;
+    }
+
+    if(IsInline()) {
+        char* heap = (char *)malloc(sizeof(char) * new_len);
+        memcpy(heap, inline_buffer, len);
+        buffer = heap;
+    }
+    else {
+        buffer = (char *)realloc(buffer, sizeof(char) * new_len);
     }
-    buffer = (char *)realloc(buffer, sizeof(char) * max_len);
+    max_len = new_len;
+}
+
+bool Buffer::IsInline() const {
+    return buffer == inline_buffer;
 }
 
 void Buffer::PrintBuffer(const char* buff, const int len) {
@@ -203,16 +301,20 @@ void Buffer::PrintBuffer(const char* buff, const int len) {
 
 uint24_t& uint24_t::operator=(const uint32_t& value) {
     value_ = 0x00FFFFFF & value;
+    return *this;
 }
 
 uint40_t& uint40_t::operator=(const uint64_t& value) {
     value_ = 0x000000FFFFFFFFFF & value;
+    return *this;
 }
 
 uint48_t& uint48_t::operator=(const uint64_t& value) {
     value_ = 0x0000FFFFFFFFFFFF & value;
+    return *this;
 }
 
 uint52_t& uint52_t::operator=(const uint64_t& value) {
     value_ = 0x00FFFFFFFFFFFFFF & value;
+    return *this;
 }
\ No newline at end of file
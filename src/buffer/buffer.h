@@ -3,12 +3,17 @@
 
 #include <cstdint>
 
+// Payloads up to this size are kept inside the Buffer itself without touching the heap.
+#define BUFFER_INLINE_SIZE 64
+
 struct Buffer {
 public:
     Buffer();
     Buffer(const unsigned int buff_len);
     Buffer(const char* str);
     Buffer(const char* str, const unsigned int str_len);
+    Buffer(const struct Buffer& a);
+    Buffer(struct Buffer&& a);
     ~Buffer();
 
     void Append(const struct Buffer& a);
@@ -20,6 +25,12 @@ public:
     void Copy(const char ch, const unsigned int at = 0);
 
     unsigned int Length() const;
+    unsigned int Capacity() const;
+
+    // Capacity only grows, Resize() and Clear() never give memory back.
+    // ShrinkToFit() is the only way to release it.
+    void Reserve(const unsigned int capacity);
+    void ShrinkToFit();
 
     void Resize(const unsigned int buff_len);
     void Clear();
@@ -37,6 +48,7 @@ public:
     char& operator[](const unsigned int i);
 
     struct Buffer& operator=(const struct Buffer& a);
+    struct Buffer& operator=(struct Buffer&& a);
     struct Buffer& operator=(const char* str);
 
     struct Buffer& operator+(const struct Buffer& a);
@@ -51,10 +63,12 @@ public:
 
 private:
     void UpdateBufferSize(const unsigned int min);
+    bool IsInline() const;
 
-    char* buffer = nullptr;
+    char* buffer = inline_buffer;
     unsigned int len = 0;
-    unsigned int max_len = 8;
+    unsigned int max_len = BUFFER_INLINE_SIZE;
+    char inline_buffer[BUFFER_INLINE_SIZE];
 };
 
 struct uint24_t {
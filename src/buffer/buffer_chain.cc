@@ -0,0 +1,197 @@
+#include <cstring>
+
+#include "buffer_chain.h"
+#include "buffer_pool.h"
+
+BufferChain::BufferChain() {
+}
+
+BufferChain::BufferChain(BufferChain&& a) {
+    MoveFrom(a);
+}
+
+BufferChain::~BufferChain() {
+    Clear();
+}
+
+struct BufferChain& BufferChain::operator=(struct BufferChain&& a) {
+    if(this == &a) return *this;
+
+    Clear();
+    MoveFrom(a);
+    return *this;
+}
+
+void BufferChain::Append(const char* buff, const unsigned int buff_len) {
+    if(buff == nullptr || buff_len == 0) return;
+
+    // Adjacent borrowed slices are merged so that the kernel sees fewer iovecs.
+    if(slice_cnt_ > 0 && SliceAt(slice_cnt_ - 1).base + SliceAt(slice_cnt_ - 1).len == buff) {
+        SliceAt(slice_cnt_ - 1).len = SliceAt(slice_cnt_ - 1).len + buff_len;
+    }
+    else {
+        Slice slice = {buff, buff_len};
+        PushSlice(slice);
+    }
+    len_ = len_ + buff_len;
+}
+
+void BufferChain::Append(const struct Buffer& buff) {
+    Append(buff.Address(), buff.Length());
+}
+
+void BufferChain::Append(struct Buffer* buff) {
+    if(buff == nullptr) return;
+    PushOwned(buff);
+    Append(buff->Address(), buff->Length());
+}
+
+void BufferChain::Append(const struct BufferSlice& slice) {
+    if(slice.Empty() == true) return;
+
+    BufferBlock* block = slice.Block();
+    block->Ref();
+    PushBlock(block);
+    Append(slice.Address(), slice.Length());
+}
+
+void BufferChain::Append(struct BufferChain&& chain) {
+    unsigned int i;
+
+    for(i = 0; i < chain.slice_cnt_; i++) {
+        Append(chain.SliceAt(i).base, chain.SliceAt(i).len);
+    }
+    for(i = 0; i < chain.owned_cnt_; i++) {
+        PushOwned(chain.OwnedAt(i));
+    }
+    for(i = 0; i < chain.block_cnt_; i++) {
+        PushBlock(chain.BlockAt(i));
+    }
+
+    chain.more_slices_.clear();
+    chain.more_owned_.clear();
+    chain.more_blocks_.clear();
+    chain.slice_cnt_ = 0;
+    chain.owned_cnt_ = 0;
+    chain.block_cnt_ = 0;
+    chain.len_ = 0;
+}
+
+unsigned int BufferChain::Length() const {
+    return len_;
+}
+
+unsigned int BufferChain::Count() const {
+    return slice_cnt_;
+}
+
+const BufferChain::Slice& BufferChain::operator[](const unsigned int i) const {
+    return SliceAt(i);
+}
+
+unsigned int BufferChain::FillIovec(struct iovec* iov, const unsigned int max, unsigned int offset) const {
+    unsigned int i, cnt = 0;
+
+    for(i = 0; i < slice_cnt_ && cnt < max; i++) {
+        const Slice& slice = SliceAt(i);
+        if(offset >= slice.len) {
+            offset = offset - slice.len;
+            continue;
+        }
+        iov[cnt].iov_base = (void *)(slice.base + offset);
+        iov[cnt].iov_len = slice.len - offset;
+        offset = 0;
+        cnt++;
+    }
+
+    return cnt;
+}
+
+void BufferChain::Flatten(struct Buffer& target) const {
+    target.Clear();
+    target.Reserve(len_);
+    for(unsigned int i = 0; i < slice_cnt_; i++) {
+        target.Append(SliceAt(i).base, SliceAt(i).len);
+    }
+}
+
+void BufferChain::Clear() {
+    for(unsigned int i = 0; i < owned_cnt_; i++) {
+        BufferPool::Release(OwnedAt(i));
+    }
+    for(unsigned int i = 0; i < block_cnt_; i++) {
+        BlockAt(i)->Unref();
+    }
+    more_owned_.clear();
+    more_slices_.clear();
+    more_blocks_.clear();
+    slice_cnt_ = 0;
+    owned_cnt_ = 0;
+    block_cnt_ = 0;
+    len_ = 0;
+}
+
+void BufferChain::Print() const {
+    for(unsigned int i = 0; i < slice_cnt_; i++) {
+        Buffer::PrintBuffer(SliceAt(i).base, SliceAt(i).len);
+    }
+}
+
+void BufferChain::PushSlice(const Slice& slice) {
+    if(slice_cnt_ < BUFFER_CHAIN_INLINE_SLICES) inline_slices_[slice_cnt_] = slice;
+    else more_slices_.push_back(slice);
+    slice_cnt_++;
+}
+
+void BufferChain::PushOwned(struct Buffer* buff) {
+    if(owned_cnt_ < BUFFER_CHAIN_INLINE_OWNED) inline_owned_[owned_cnt_] = buff;
+    else more_owned_.push_back(buff);
+    owned_cnt_++;
+}
+
+void BufferChain::PushBlock(struct BufferBlock* block) {
+    if(block_cnt_ < BUFFER_CHAIN_INLINE_BLOCKS) inline_blocks_[block_cnt_] = block;
+    else more_blocks_.push_back(block);
+    block_cnt_++;
+}
+
+BufferChain::Slice& BufferChain::SliceAt(const unsigned int i) {
+    if(i < BUFFER_CHAIN_INLINE_SLICES) return inline_slices_[i];
+    return more_slices_[i - BUFFER_CHAIN_INLINE_SLICES];
+}
+
+const BufferChain::Slice& BufferChain::SliceAt(const unsigned int i) const {
+    if(i < BUFFER_CHAIN_INLINE_SLICES) return inline_slices_[i];
+    return more_slices_[i - BUFFER_CHAIN_INLINE_SLICES];
+}
+
+struct Buffer* BufferChain::OwnedAt(const unsigned int i) const {
+    if(i < BUFFER_CHAIN_INLINE_OWNED) return inline_owned_[i];
+    return more_owned_[i - BUFFER_CHAIN_INLINE_OWNED];
+}
+
+struct BufferBlock* BufferChain::BlockAt(const unsigned int i) const {
+    if(i < BUFFER_CHAIN_INLINE_BLOCKS) return inline_blocks_[i];
+    return more_blocks_[i - BUFFER_CHAIN_INLINE_BLOCKS];
+}
+
+void BufferChain::MoveFrom(struct BufferChain& a) {
+    memcpy(inline_slices_, a.inline_slices_, sizeof(Slice) * BUFFER_CHAIN_INLINE_SLICES);
+    memcpy(inline_owned_, a.inline_owned_, sizeof(struct Buffer*) * BUFFER_CHAIN_INLINE_OWNED);
+    memcpy(inline_blocks_, a.inline_blocks_, sizeof(struct BufferBlock*) * BUFFER_CHAIN_INLINE_BLOCKS);
+    more_slices_.swap(a.more_slices_);
+    more_owned_.swap(a.more_owned_);
+    more_blocks_.swap(a.more_blocks_);
+    slice_cnt_ = a.slice_cnt_;
+    owned_cnt_ = a.owned_cnt_;
+    block_cnt_ = a.block_cnt_;
+    len_ = a.len_;
+
+    a.more_slices_.clear();
+    a.more_owned_.clear();
+    a.more_blocks_.clear();
+    a.slice_cnt_ = 0;
+    a.owned_cnt_ = 0;
+    a.block_cnt_ = 0;
+    a.len_ = 0;
+}
@@ -0,0 +1,92 @@
+#ifndef _LHTTP2_BUFFER_CHAIN_H_
+#define _LHTTP2_BUFFER_CHAIN_H_
+
+#include <vector>
+#include <sys/uio.h>
+
+#include "buffer.h"
+#include "buffer_slice.h"
+
+// Slices, owned Buffers and pinned blocks kept inside the chain before it spills to the heap.
+#define BUFFER_CHAIN_INLINE_SLICES 8
+#define BUFFER_CHAIN_INLINE_OWNED 4
+#define BUFFER_CHAIN_INLINE_BLOCKS 2
+
+/*
+    ### Buffer chain ###
+
+    A list of iovec-style slices which together form one contiguous byte stream
+    on the wire. A slice either borrows memory owned by someone else (for example
+    static padding octets) or points into a Buffer owned by the chain.
+    Borrowed memory must stay untouched until the chain is written or destroyed.
+
+    Owned Buffers are returned to the thread-local BufferPool when the chain is
+    cleared, so take them from BufferPool::Acquire() to avoid the heap entirely.
+    A BufferSlice is appended without copying as well, the chain holds a
+    reference on its block, so the bytes stay valid however long it lives.
+*/
+struct BufferChain {
+public:
+    struct Slice {
+        const char* base;
+        unsigned int len;
+    };
+
+    BufferChain();
+    BufferChain(BufferChain&& a);
+    ~BufferChain();
+
+    BufferChain(const BufferChain& a) = delete;
+    struct BufferChain& operator=(const struct BufferChain& a) = delete;
+    struct BufferChain& operator=(struct BufferChain&& a);
+
+    // Borrowed slices, nothing is copied.
+    void Append(const char* buff, const unsigned int buff_len);
+    void Append(const struct Buffer& buff);
+
+    // The chain takes the ownership of buff and releases it to the BufferPool on destruction.
+    // buff must not be modified after it has been appended.
+    void Append(struct Buffer* buff);
+
+    // The chain references the block of slice until it is cleared.
+    void Append(const struct BufferSlice& slice);
+
+    // Moves every slice, owned Buffer and block reference of chain to the end of this chain.
+    void Append(struct BufferChain&& chain);
+
+    unsigned int Length() const;
+    unsigned int Count() const;
+    const Slice& operator[](const unsigned int i) const;
+
+    // Fills up to max iovecs describing the bytes after offset and returns the number of iovecs filled.
+    unsigned int FillIovec(struct iovec* iov, const unsigned int max, unsigned int offset = 0) const;
+
+    // Copies the whole chain into one contiguous Buffer.
+    void Flatten(struct Buffer& target) const;
+
+    void Clear();
+    void Print() const;
+
+private:
+    void PushSlice(const Slice& slice);
+    void PushOwned(struct Buffer* buff);
+    Slice& SliceAt(const unsigned int i);
+    const Slice& SliceAt(const unsigned int i) const;
+    struct Buffer* OwnedAt(const unsigned int i) const;
+    struct BufferBlock* BlockAt(const unsigned int i) const;
+    void PushBlock(struct BufferBlock* block);
+    void MoveFrom(struct BufferChain& a);
+
+    Slice inline_slices_[BUFFER_CHAIN_INLINE_SLICES];
+    struct Buffer* inline_owned_[BUFFER_CHAIN_INLINE_OWNED];
+    std::vector<Slice> more_slices_;
+    std::vector<struct Buffer*> more_owned_;
+    struct BufferBlock* inline_blocks_[BUFFER_CHAIN_INLINE_BLOCKS];
+    std::vector<struct BufferBlock*> more_blocks_;
+    unsigned int slice_cnt_ = 0;
+    unsigned int owned_cnt_ = 0;
+    unsigned int block_cnt_ = 0;
+    unsigned int len_ = 0;
+};
+
+#endif
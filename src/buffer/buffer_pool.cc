@@ -0,0 +1,103 @@
+#include <vector>
+
+#include "buffer_pool.h"
+
+namespace {
+    struct LocalPool {
+        LocalPool() {
+            for(int i = 0; i < BUFFER_POOL_CLASS_COUNT; i++) {
+                free_lists[i].reserve(BUFFER_POOL_CLASS_DEPTH);
+            }
+        }
+
+        ~LocalPool() {
+            Trim();
+        }
+
+        void Trim() {
+            for(int i = 0; i < BUFFER_POOL_CLASS_COUNT; i++) {
+                for(unsigned int j = 0; j < free_lists[i].size(); j++) {
+                    delete free_lists[i][j];
+                }
+                free_lists[i].clear();
+            }
+        }
+
+        std::vector<struct Buffer*> free_lists[BUFFER_POOL_CLASS_COUNT];
+        BufferPool::Stats stats;
+    };
+
+    thread_local LocalPool local_pool;
+
+    unsigned int ClassSize(const int idx) {
+        return (unsigned int)BUFFER_INLINE_SIZE << idx;
+    }
+
+    // Smallest class which can hold capacity bytes, or -1 when it is too large.
+    int AcquireClass(const unsigned int capacity) {
+        for(int i = 0; i < BUFFER_POOL_CLASS_COUNT; i++) {
+            if(capacity <= ClassSize(i)) return i;
+        }
+        return -1;
+    }
+
+    // Largest class whose size a Buffer of this capacity covers.
+    int ReleaseClass(const unsigned int capacity) {
+        for(int i = BUFFER_POOL_CLASS_COUNT - 1; i >= 0; i--) {
+            if(capacity >= ClassSize(i)) return i;
+        }
+        return -1;
+    }
+}
+
+double BufferPool::Stats::HitRate() const {
+    if(hits + misses == 0) return 0.0;
+    return (double)hits / (double)(hits + misses);
+}
+
+struct Buffer* BufferPool::Acquire(const unsigned int capacity) {
+    LocalPool& pool = local_pool;
+    int idx = AcquireClass(capacity);
+
+    // Any Buffer of a larger class fits as well.
+    for(int i = idx; i >= 0 && i < BUFFER_POOL_CLASS_COUNT; i++) {
+        if(pool.free_lists[i].empty() == false) {
+            struct Buffer* buff = pool.free_lists[i].back();
+            pool.free_lists[i].pop_back();
+            pool.stats.hits++;
+            return buff;
+        }
+    }
+
+    pool.stats.misses++;
+    return new Buffer(capacity);
+}
+
+void BufferPool::Release(struct Buffer* buff) {
+    if(buff == nullptr) return;
+
+    LocalPool& pool = local_pool;
+    int idx = ReleaseClass(buff->Capacity());
+
+    if(idx < 0 || buff->Capacity() > ClassSize(BUFFER_POOL_CLASS_COUNT - 1) || pool.free_lists[idx].size() >= BUFFER_POOL_CLASS_DEPTH) {
+        pool.stats.discards++;
+        delete buff;
+        return;
+    }
+
+    buff->Clear();
+    pool.free_lists[idx].push_back(buff);
+    pool.stats.releases++;
+}
+
+const BufferPool::Stats& BufferPool::GetStats() {
+    return local_pool.stats;
+}
+
+void BufferPool::ResetStats() {
+    local_pool.stats = Stats();
+}
+
+void BufferPool::Trim() {
+    local_pool.Trim();
+}
@@ -0,0 +1,67 @@
+#ifndef _LHTTP2_BUFFER_POOL_H_
+#define _LHTTP2_BUFFER_POOL_H_
+
+#include <cstdint>
+
+#include "buffer.h"
+
+#define BUFFER_POOL_CLASS_COUNT 11      // BUFFER_INLINE_SIZE (64) ... 64 KB
+#define BUFFER_POOL_CLASS_DEPTH 64      // Buffers kept per class and thread
+
+/*
+    ### Buffer pool ###
+
+    Thread-local free lists of Buffers grouped by capacity class. Acquire()
+    hands out an empty Buffer whose capacity is at least the requested size,
+    Release() clears it and keeps the allocation for the next Acquire() on the
+    same thread. Buffers are never shared between threads, so no locking is
+    needed. A Buffer may be released on another thread than the one it was
+    acquired on; it simply joins that thread's pool.
+*/
+struct BufferPool {
+public:
+    struct Stats {
+        uint64_t hits = 0;          // Acquire() served from a free list
+        uint64_t misses = 0;        // Acquire() which had to allocate
+        uint64_t releases = 0;      // Release() kept in a free list
+        uint64_t discards = 0;      // Release() freed because the class was full or too large
+
+        double HitRate() const;
+    };
+
+    static struct Buffer* Acquire(const unsigned int capacity = 0);
+    static void Release(struct Buffer* buff);
+
+    // Statistics and cached Buffers of the calling thread.
+    static const Stats& GetStats();
+    static void ResetStats();
+    static void Trim();
+};
+
+/*
+    Scoped handle which acquires a Buffer from the pool and releases it back
+    when it goes out of scope, for scratch Buffers on encode/decode paths.
+*/
+struct PooledBuffer {
+public:
+    PooledBuffer(const unsigned int capacity = 0) : buff_(BufferPool::Acquire(capacity)) {}
+    ~PooledBuffer() { BufferPool::Release(buff_); }
+
+    PooledBuffer(const struct PooledBuffer& a) = delete;
+    void operator=(const struct PooledBuffer& a) = delete;
+
+    struct Buffer& operator*() const { return *buff_; }
+    struct Buffer* operator->() const { return buff_; }
+
+    // Gives up the ownership, e.g. to hand the Buffer over to a BufferChain.
+    struct Buffer* Detach() {
+        struct Buffer* buff = buff_;
+        buff_ = nullptr;
+        return buff;
+    }
+
+private:
+    struct Buffer* buff_;
+};
+
+#endif
@@ -0,0 +1,159 @@
+#include <cstring>
+#include <new>
+
+#include "buffer_slice.h"
+
+/*
+    Implementation of buffer block
+*/
+BufferBlock::BufferBlock(const unsigned int size, lhttp2::MemoryResource* resource) : refs_(1), size_(size), resource_(resource) {
+}
+
+struct BufferBlock* BufferBlock::Create(const unsigned int size, lhttp2::MemoryResource* resource) {
+    if(resource == nullptr) resource = lhttp2::NewDeleteResource();
+
+    void* mem = resource->Allocate(sizeof(struct BufferBlock) + size);
+    if(mem == nullptr) return nullptr;
+    return new (mem) BufferBlock(size, resource);
+}
+
+void BufferBlock::Ref() {
+    refs_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void BufferBlock::Unref() {
+    if(refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        lhttp2::MemoryResource* resource = resource_;
+        unsigned int size = size_;
+        this->~BufferBlock();
+        resource->Deallocate(this, sizeof(struct BufferBlock) + size);
+    }
+}
+
+bool BufferBlock::Unique() const {
+    return refs_.load(std::memory_order_acquire) == 1;
+}
+
+char* BufferBlock::Address() {
+    return (char *)(this + 1);
+}
+
+const char* BufferBlock::Address() const {
+    return (const char *)(this + 1);
+}
+
+unsigned int BufferBlock::Size() const {
+    return size_;
+}
+
+/*
+    Implementation of buffer slice
+*/
+BufferSlice::BufferSlice() {
+}
+
+BufferSlice::BufferSlice(struct BufferBlock* block, const unsigned int offset, const unsigned int len) {
+    if(block == nullptr || offset + len > block->Size()) return;
+
+    block->Ref();
+    block_ = block;
+    data_ = block->Address() + offset;
+    len_ = len;
+}
+
+BufferSlice::BufferSlice(const struct Buffer& buff) : BufferSlice(buff.Address(), buff.Length()) {
+}
+
+BufferSlice::BufferSlice(const char* buff, const unsigned int buff_len) {
+    if(buff == nullptr || buff_len == 0) return;
+
+    block_ = BufferBlock::Create(buff_len);
+    if(block_ == nullptr) return;
+
+    memcpy(block_->Address(), buff, buff_len);
+    data_ = block_->Address();
+    len_ = buff_len;
+}
+
+BufferSlice::BufferSlice(const struct BufferSlice& a) : block_(a.block_), data_(a.data_), len_(a.len_) {
+    if(block_ != nullptr) block_->Ref();
+}
+
+BufferSlice::BufferSlice(struct BufferSlice&& a) : block_(a.block_), data_(a.data_), len_(a.len_) {
+    a.block_ = nullptr;
+    a.data_ = nullptr;
+    a.len_ = 0;
+}
+
+BufferSlice::~BufferSlice() {
+    Clear();
+}
+
+struct BufferSlice& BufferSlice::operator=(const struct BufferSlice& a) {
+    if(this == &a) return *this;
+
+    if(a.block_ != nullptr) a.block_->Ref();
+    Clear();
+    block_ = a.block_;
+    data_ = a.data_;
+    len_ = a.len_;
+    return *this;
+}
+
+struct BufferSlice& BufferSlice::operator=(struct BufferSlice&& a) {
+    if(this == &a) return *this;
+
+    Clear();
+    block_ = a.block_;
+    data_ = a.data_;
+    len_ = a.len_;
+    a.block_ = nullptr;
+    a.data_ = nullptr;
+    a.len_ = 0;
+    return *this;
+}
+
+unsigned int BufferSlice::Length() const {
+    return len_;
+}
+
+bool BufferSlice::Empty() const {
+    return len_ == 0;
+}
+
+const char* BufferSlice::Address(const unsigned int idx) const {
+    if(idx >= len_) return nullptr;
+    return data_ + idx;
+}
+
+char BufferSlice::Get(const unsigned int idx) const {
+    if(idx >= len_) return '\0';
+    return data_[idx];
+}
+
+struct BufferBlock* BufferSlice::Block() const {
+    return block_;
+}
+
+struct BufferSlice BufferSlice::Slice(const unsigned int offset, const unsigned int len) const {
+    if(block_ == nullptr || offset >= len_) return BufferSlice();
+
+    unsigned int sub_len = (len > len_ - offset) ? len_ - offset : len;
+    return BufferSlice(block_, (data_ - block_->Address()) + offset, sub_len);
+}
+
+void BufferSlice::CopyTo(struct Buffer& target) const {
+    target.Clear();
+    target.Append(data_, len_);
+}
+
+void BufferSlice::Clear() {
+    if(block_ != nullptr) block_->Unref();
+    block_ = nullptr;
+    data_ = nullptr;
+    len_ = 0;
+}
+
+void BufferSlice::Print() const {
+    Buffer::PrintBuffer(data_, len_);
+}
@@ -0,0 +1,89 @@
+#ifndef _LHTTP2_BUFFER_SLICE_H_
+#define _LHTTP2_BUFFER_SLICE_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "buffer.h"
+#include "../memory/memory_resource.h"
+
+/*
+    ### Buffer block ###
+
+    Reference counted, fixed size block of memory. The counter and the data are
+    allocated together. A block is created with one reference which belongs to
+    the creator, and is freed when the last reference is dropped. The memory
+    comes from the given resource, or from malloc when none is given.
+*/
+struct BufferBlock {
+public:
+    static struct BufferBlock* Create(const unsigned int size, lhttp2::MemoryResource* resource = nullptr);
+
+    void Ref();
+    void Unref();
+
+    // Whether the caller holds the only reference, so the memory may be reused.
+    bool Unique() const;
+
+    char* Address();
+    const char* Address() const;
+    unsigned int Size() const;
+
+    BufferBlock(const struct BufferBlock& a) = delete;
+    void operator=(const struct BufferBlock& a) = delete;
+
+private:
+    BufferBlock(const unsigned int size, lhttp2::MemoryResource* resource);
+
+    std::atomic<unsigned int> refs_;
+    unsigned int size_;
+    lhttp2::MemoryResource* resource_;
+};
+
+/*
+    ### Buffer slice ###
+
+    Immutable view of a byte range inside a BufferBlock. Copying a slice only
+    takes another reference on the block, so payloads can be handed around
+    (forwarded to a backend, written to disk, ...) without copying the bytes.
+*/
+struct BufferSlice {
+public:
+    BufferSlice();
+    BufferSlice(struct BufferBlock* block, const unsigned int offset, const unsigned int len);
+
+    // These copy the bytes into a new block.
+    BufferSlice(const struct Buffer& buff);
+    BufferSlice(const char* buff, const unsigned int buff_len);
+
+    BufferSlice(const struct BufferSlice& a);
+    BufferSlice(struct BufferSlice&& a);
+    ~BufferSlice();
+
+    struct BufferSlice& operator=(const struct BufferSlice& a);
+    struct BufferSlice& operator=(struct BufferSlice&& a);
+
+    unsigned int Length() const;
+    bool Empty() const;
+
+    const char* Address(const unsigned int idx = 0) const;
+    char Get(const unsigned int idx) const;
+
+    // Block the slice points into, nullptr for an empty slice.
+    struct BufferBlock* Block() const;
+
+    // Returns a slice sharing the same block, clamped to the bounds of this slice.
+    struct BufferSlice Slice(const unsigned int offset, const unsigned int len) const;
+
+    void CopyTo(struct Buffer& target) const;
+    void Clear();
+
+    void Print() const;
+
+private:
+    struct BufferBlock* block_ = nullptr;
+    const char* data_ = nullptr;
+    unsigned int len_ = 0;
+};
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef _LHTTP2_BYTE_CURSOR_H_
+#define _LHTTP2_BYTE_CURSOR_H_
+
+#include <cstdint>
+#include <cstring>
+
+#include "buffer.h"
+
+/*
+    ### Big-endian byte cursors ###
+
+    ByteReader and ByteWriter walk a byte range and read or write network order
+    integers of a fixed width. Every access is one unaligned load or store plus
+    a byte swap, so a 32-bit field compiles down to a mov and a bswap.
+
+    Both cursors are bounds checked. An access which does not fit into the
+    remaining bytes reads as 0 (or writes nothing), does not move the cursor
+    and marks the cursor as failed. Check Ok() once after a run of accesses.
+*/
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define LHTTP2_BE16(x) (x)
+#define LHTTP2_BE32(x) (x)
+#define LHTTP2_BE64(x) (x)
+#elif defined(__GNUC__) || defined(__clang__)
+#define LHTTP2_BE16(x) __builtin_bswap16(x)
+#define LHTTP2_BE32(x) __builtin_bswap32(x)
+#define LHTTP2_BE64(x) __builtin_bswap64(x)
+#else
+#define LHTTP2_BE16(x) ((uint16_t)((((x) & 0x00FF) << 8) | (((x) & 0xFF00) >> 8)))
+#define LHTTP2_BE32(x) ((((x) & 0x000000FFU) << 24) | (((x) & 0x0000FF00U) << 8) | \
+                        (((x) & 0x00FF0000U) >> 8) | (((x) & 0xFF000000U) >> 24))
+#define LHTTP2_BE64(x) (((uint64_t)LHTTP2_BE32((uint32_t)(x)) << 32) | LHTTP2_BE32((uint32_t)((x) >> 32)))
+#endif
+
+namespace byte_order {
+    template <unsigned int BYTES>
+    inline uint64_t Load(const char* p);
+
+    template <unsigned int BYTES>
+    inline void Store(char* p, const uint64_t value);
+
+    template <>
+    inline uint64_t Load<1>(const char* p) {
+        return (uint8_t)p[0];
+    }
+
+    template <>
+    inline uint64_t Load<2>(const char* p) {
+        uint16_t v;
+        memcpy(&v, p, 2);
+        return LHTTP2_BE16(v);
+    }
+
+    template <>
+    inline uint64_t Load<3>(const char* p) {
+        return (Load<2>(p) << 8) | (uint8_t)p[2];
+    }
+
+    template <>
+    inline uint64_t Load<4>(const char* p) {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return LHTTP2_BE32(v);
+    }
+
+    template <>
+    inline uint64_t Load<8>(const char* p) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        return LHTTP2_BE64(v);
+    }
+
+    template <>
+    inline void Store<1>(char* p, const uint64_t value) {
+        p[0] = (char)value;
+    }
+
+    template <>
+    inline void Store<2>(char* p, const uint64_t value) {
+        uint16_t v = LHTTP2_BE16((uint16_t)value);
+        memcpy(p, &v, 2);
+    }
+
+    template <>
+    inline void Store<3>(char* p, const uint64_t value) {
+        Store<2>(p, value >> 8);
+        p[2] = (char)value;
+    }
+
+    template <>
+    inline void Store<4>(char* p, const uint64_t value) {
+        uint32_t v = LHTTP2_BE32((uint32_t)value);
+        memcpy(p, &v, 4);
+    }
+
+    template <>
+    inline void Store<8>(char* p, const uint64_t value) {
+        uint64_t v = LHTTP2_BE64(value);
+        memcpy(p, &v, 8);
+    }
+}
+
+struct ByteReader {
+public:
+    ByteReader(const char* buff, const unsigned int len) : buff_(buff), len_(len) {}
+
+    uint8_t U8() { return (uint8_t)Read<1>(); }
+    uint16_t U16() { return (uint16_t)Read<2>(); }
+    uint32_t U24() { return (uint32_t)Read<3>(); }
+    uint32_t U32() { return (uint32_t)Read<4>(); }
+    uint64_t U64() { return Read<8>(); }
+
+    // 31-bit field behind a single flag bit (R or E), as used by stream identifiers.
+    uint32_t U31() { return U32() & 0x7FFFFFFF; }
+    uint32_t U31(bool& flag) {
+        uint32_t v = U32();
+        flag = ((v & 0x80000000) == 0x80000000);
+        return v & 0x7FFFFFFF;
+    }
+
+    // Returns the address of the next len bytes and moves past them.
+    const char* Bytes(const unsigned int len) {
+        if(Remaining() < len) return Fail();
+        const char* p = buff_ + pos_;
+        pos_ = pos_ + len;
+        return p;
+    }
+
+    void Skip(const unsigned int len) { Bytes(len); }
+
+    bool Ok() const { return ok_; }
+    unsigned int Position() const { return pos_; }
+    unsigned int Remaining() const { return len_ - pos_; }
+    const char* Current() const { return buff_ + pos_; }
+
+private:
+    template <unsigned int BYTES>
+    uint64_t Read() {
+        if(Remaining() < BYTES) {
+            Fail();
+            return 0;
+        }
+        uint64_t v = byte_order::Load<BYTES>(buff_ + pos_);
+        pos_ = pos_ + BYTES;
+        return v;
+    }
+
+    const char* Fail() {
+        ok_ = false;
+        return nullptr;
+    }
+
+    const char* buff_;
+    unsigned int len_;
+    unsigned int pos_ = 0;
+    bool ok_ = true;
+};
+
+struct ByteWriter {
+public:
+    ByteWriter(char* buff, const unsigned int len) : buff_(buff), len_(len) {}
+
+    // Resizes buff to exactly len bytes and writes into it from the start.
+    ByteWriter(struct Buffer& buff, const unsigned int len) : len_(len) {
+        buff.Resize(len);
+        buff_ = (len > 0) ? &buff[0] : nullptr;
+    }
+
+    void U8(const uint8_t value) { Write<1>(value); }
+    void U16(const uint16_t value) { Write<2>(value); }
+    void U24(const uint32_t value) { Write<3>(value); }
+    void U32(const uint32_t value) { Write<4>(value); }
+    void U64(const uint64_t value) { Write<8>(value); }
+
+    void U31(const uint32_t value, const bool flag = false) {
+        U32(((uint32_t)flag << 31) | (value & 0x7FFFFFFF));
+    }
+
+    void Bytes(const char* buff, const unsigned int len) {
+        if(Remaining() < len) {
+            ok_ = false;
+            return;
+        }
+        if(len > 0) memcpy(buff_ + pos_, buff, len);
+        pos_ = pos_ + len;
+    }
+
+    bool Ok() const { return ok_; }
+    unsigned int Position() const { return pos_; }
+    unsigned int Remaining() const { return len_ - pos_; }
+
+private:
+    template <unsigned int BYTES>
+    void Write(const uint64_t value) {
+        if(Remaining() < BYTES) {
+            ok_ = false;
+            return;
+        }
+        byte_order::Store<BYTES>(buff_ + pos_, value);
+        pos_ = pos_ + BYTES;
+    }
+
+    char* buff_;
+    unsigned int len_;
+    unsigned int pos_ = 0;
+    bool ok_ = true;
+};
+
+#endif
@@ -1,8 +1,11 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#include <errno.h>
+#include <cstring>
 
 #include "connection.h"
+#include "buffer/buffer_pool.h"
 
 using namespace lhttp2;
 
@@ -13,32 +16,81 @@ using namespace lhttp2;
 
 static const char preface[] = PREFACE;
 
-Connection::Connection(int fd, ENDPOINT_TYPE type, lhttp2::Settings settings) : fd_(fd), type_(type), settings_(settings) {
+// Header of a DATA frame whose payload follows from somewhere else.
+static BufferChain DataFrameHeader(uint32_t streamId, uint32_t length, uint8_t flags) {
+    Buffer* header = BufferPool::Acquire(FRAME_HEADER_LENGTH);
+
+    ByteWriter writer(*header, FRAME_HEADER_LENGTH);
+    writer.U24(length);
+    writer.U8(Frame::TYPE_DATA_FRAME);
+    writer.U8(flags);
+    writer.U31(streamId);
+
+    BufferChain chain;
+    chain.Append(header);
+    return chain;
+}
+
+static bool IsEndOfStream(const Frame* frame) {
+    if(frame->type() == Frame::TYPE_RST_STREAM_FRAME) return true;
+    if(frame->type() == Frame::TYPE_DATA_FRAME || frame->type() == Frame::TYPE_HEADERS_FRAME)
+        return frame->has_flags(Frame::FLAG_END_STREAM);
+    return false;
+}
+
+Connection::Connection(int fd, ENDPOINT_TYPE type, lhttp2::Settings settings, IO_MODE mode) : fd_(fd), type_(type), mode_(mode), settings_(settings) {
+    hpack_decoder_.SetMaxHeaderListSize(settings_.max_header_list_size());
+    parser_.SetMaxFrameSize(settings_.max_frame_size());
+
+    // The handshake goes out with the first Flush() and comes in through Receive().
+    if(mode_ == IO_NON_BLOCKING) {
+        if(type_ == ENDPOINT_CLIENT) {
+            BufferChain chain;
+            chain.Append(preface, PREFACE_LEN);
+            write_queue_.Push(std::move(chain));
+            QueueSettings(false);
+            state_ = STATE_SETTINGS;
+        }
+        else {
+            state_ = STATE_PREFACE;
+        }
+        return;
+    }
+
     if(type_ == ENDPOINT_CLIENT) {
         SendPreface();
         SettingsFrame settings_frame;
         settings_frame.set_settings(settings_);
-        Frame::SendFrame(fd, &settings_frame, hpack_table_);
+        Frame::SendFrame(fd, &settings_frame, hpack_encoder_);
     }
     else if(type_ == ENDPOINT_SERVER) {
         if(RecvPreface() == false) {
             ::close(fd_);
+            state_ = STATE_CLOSED;
             return;
         }
 
-        Frame* frame = Frame::RecvFrame(fd, hpack_table_);
-        if(frame->type() != Frame::TYPE_SETTINGS_FRAME) {
+        Frame* frame = Frame::RecvFrame(fd, hpack_decoder_, resource_);
+        if(frame == nullptr || frame->type() != Frame::TYPE_SETTINGS_FRAME) {
+            delete frame;
             ::close(fd_);
+            state_ = STATE_CLOSED;
             return;
         }
 
-        settings_ = ((SettingsFrame*)frame)->settings();
+        ApplyReceived(frame);
         delete frame;
+        Flush();
+    }
+}
 
-        SettingsFrame settings_frame;
-        settings_frame.set_ack_flag();
-        Frame::SendFrame(fd_, &settings_frame, hpack_table_);
+Connection::~Connection() {
+    for(size_t i = received_next_; i < received_.size(); i++) {
+        delete received_[i];
     }
+    delete pending_headers_;
+    if(read_block_ != nullptr) read_block_->Unref();
+    arena_->Release();
 }
 
 uint32_t Connection::AllocateStream() {
@@ -50,32 +102,201 @@ uint32_t Connection::AllocateStream() {
     return 0;
 }
 
-void Connection::SendFrame(uint32_t streamId, Frame* frame) {
-    if(streamId >= streams_.size()) {
-        return;
+bool Connection::SendFrame(uint32_t streamId, Frame* frame) {
+    // Connection control frames (stream 0) and streams which are not tracked go out as they are.
+    if(streamId != 0 && streamId < streams_.size()) {
+        Stream& stream = streams_[streamId];
+
+        switch(stream.status()) {
+            case Stream::HTTP2_STREAM_IDLE : break;
+            case Stream::HTTP2_STREAM_RESERVED : break;
+            case Stream::HTTP2_STREAM_OPEN : break;
+            case Stream::HTTP2_STREAM_HALF_CLOSED_LOCAL : break;
+            case Stream::HTTP2_STREAM_HALF_CLOSED_REMOTE : break;
+            case Stream::HTTP2_STREAM_CLOSED : break;
+            default : break;
+        }
+    }
+
+    // Checked before encoding, the HPACK encoder must only see frames which are sent.
+    if(write_queue_.Full() == true) return false;
+
+    frame->set_stream_id(streamId);
+    BufferChain chain = frame->EncodeFrame(hpack_encoder_, peer_settings_.max_frame_size());
+    if(chain.Length() == 0) return false;
+
+    write_queue_.Push(std::move(chain));
+    if(frame->type() == Frame::TYPE_DATA_FRAME) ConsumeSendWindow(streamId, frame->length());
+
+    // A stream we may send DATA on has a window from its HEADERS on until we end it.
+    if(IsEndOfStream(frame)) stream_windows_.erase(streamId);
+    else if(frame->type() == Frame::TYPE_HEADERS_FRAME) stream_windows_.emplace(streamId, peer_settings_.initial_window_size());
+
+    if(write_queue_.NeedsFlush()) return Flush();
+    return true;
+}
+
+int64_t Connection::SendFile(uint32_t streamId, int file_fd, off_t offset, uint64_t length, bool end_stream) {
+    uint64_t queued = 0, window = SendWindow(streamId) > 0 ? SendWindow(streamId) : 0;
+    uint32_t max_frame_size = peer_settings_.max_frame_size(), len;
+    uint8_t flags;
+
+    while(queued < length && queued < window) {
+        if(write_queue_.Full() == true) return (queued > 0) ? (int64_t)queued : -1;
+
+        len = max_frame_size;
+        if(len > length - queued) len = length - queued;
+        if(len > window - queued) len = window - queued;
+
+        flags = (end_stream && queued + len == length) ? Frame::FLAG_END_STREAM : 0;
+
+        write_queue_.Push(DataFrameHeader(streamId, len, flags));
+        write_queue_.PushFile(file_fd, offset + queued, len);
+
+        ConsumeSendWindow(streamId, len);
+        queued = queued + len;
+
+        if(write_queue_.NeedsFlush() && Flush() == false) return -1;
     }
 
-    Stream& stream = streams_[streamId];
+    // An empty body still ends the stream.
+    if(length == 0 && end_stream) {
+        if(write_queue_.Full() == true) return -1;
 
-    switch(stream.status()) {
-        case Stream::HTTP2_STREAM_IDLE : break;
-        case Stream::HTTP2_STREAM_RESERVED : break;
-        case Stream::HTTP2_STREAM_OPEN : break;
-        case Stream::HTTP2_STREAM_HALF_CLOSED_LOCAL : break;
-        case Stream::HTTP2_STREAM_HALF_CLOSED_REMOTE : break;
-        case Stream::HTTP2_STREAM_CLOSED : break;
-        default : break;
+        write_queue_.Push(DataFrameHeader(streamId, 0, Frame::FLAG_END_STREAM));
     }
 
-    frame->set_stream_id(streamId);
-    Frame::SendFrame(fd_, frame, hpack_table_);
+    if(end_stream && queued == length) stream_windows_.erase(streamId);
+    return queued;
+}
+
+int64_t Connection::SendWindow(uint32_t streamId) const {
+    auto it = stream_windows_.find(streamId);
+    int64_t stream_window = (it != stream_windows_.end()) ? it->second : peer_settings_.initial_window_size();
+
+    return (stream_window < window_size_) ? stream_window : window_size_;
+}
+
+void Connection::ConsumeSendWindow(uint32_t streamId, uint32_t len) {
+    auto it = stream_windows_.find(streamId);
+    if(it == stream_windows_.end()) it = stream_windows_.emplace(streamId, peer_settings_.initial_window_size()).first;
+
+    it->second = it->second - len;
+    window_size_ = window_size_ - len;
+}
+
+// WINDOW_UPDATE opens a window, a new SETTINGS_INITIAL_WINDOW_SIZE moves every stream window (RFC 7540 6.9.2).
+// Streams are tracked from the HEADERS which open them until we end them, updates for
+// any other stream are late ones for a stream we are done with and are ignored.
+void Connection::UpdateSendWindow(const Frame* frame) {
+    if(frame->type() == Frame::TYPE_WINDOW_UPDATE_FRAME) {
+        uint32_t increment = ((const WindowUpdateFrame*)frame)->window_size_increment();
+
+        if(frame->stream_id() == 0) {
+            window_size_ = window_size_ + increment;
+            return;
+        }
+
+        auto it = stream_windows_.find(frame->stream_id());
+        if(it != stream_windows_.end()) it->second = it->second + increment;
+    }
+    else if(frame->type() == Frame::TYPE_HEADERS_FRAME) {
+        // Stream identifiers only grow, a server answers every stream the client opens.
+        if(type_ == ENDPOINT_SERVER && frame->stream_id() > last_peer_stream_) {
+            last_peer_stream_ = frame->stream_id();
+            stream_windows_.emplace(frame->stream_id(), peer_settings_.initial_window_size());
+        }
+    }
+    else if(frame->type() == Frame::TYPE_RST_STREAM_FRAME) {
+        stream_windows_.erase(frame->stream_id());
+    }
+    else if(frame->type() == Frame::TYPE_SETTINGS_FRAME && frame->has_flags(Frame::FLAG_ACK) == false) {
+        const SettingsFrame* settings = (const SettingsFrame*)frame;
+        if(settings->has_parameter(SettingsFrame::SETTINGS_INITIAL_WINDOW_SIZE) == false) return;
+
+        int64_t delta = (int64_t)settings->settings().initial_window_size() - peer_settings_.initial_window_size();
+
+        for(auto& window : stream_windows_) {
+            window.second = window.second + delta;
+        }
+    }
+}
+
+bool Connection::Flush() {
+    return write_queue_.Flush(fd_);
+}
+
+void Connection::SetWriteLimits(uint32_t flush_threshold, uint32_t limit) {
+    write_queue_.SetLimits(flush_threshold, limit);
 }
 
 Frame* Connection::RecvFrame() {
-    Frame* frame = Frame::RecvFrame(fd_, hpack_table_);
+    if(release_pending_) ReleaseMemory();
+
+    // The peer may be waiting for what is still queued.
+    if(write_queue_.Empty() == false && Flush() == false) return nullptr;
+
+    Frame* frame = NextFrame();
+    if(frame == nullptr) return nullptr;
+
+    if(frame->type() == Frame::TYPE_HEADERS_FRAME && frame->has_flags(Frame::FLAG_END_HEADERS) == false) {
+        if(RecvContinuation((HeadersFrame*)frame) == false) {
+            delete frame;
+            return nullptr;
+        }
+    }
+
+    ApplyReceived(frame);
+
+    // The SETTINGS acknowledgement goes out right away.
+    if(write_queue_.Empty() == false) Flush();
     return frame;
 }
 
+bool Connection::Receive(std::vector<Frame*>& frames) {
+    ssize_t len;
+    uint32_t room;
+
+    if(release_pending_) ReleaseMemory();
+    if(state_ == STATE_CLOSED) return false;
+
+    for(;;) {
+        if(PrepareReadBlock() == false) {
+            error_ = HTTP2_ERROR_INTERNAL_ERROR;
+            return false;
+        }
+
+        room = read_block_->Size() - read_end_;
+        len = ::read(fd_, read_block_->Address() + read_end_, room);
+        if(len < 0) {
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        if(len == 0) return false;
+
+        read_end_ = read_end_ + len;
+        if((uint32_t)len == room && read_size_ < CONNECTION_READ_SIZE_MAX) read_size_ = read_size_ * 2;
+
+        if(ParseReceived(frames) == false) return false;
+    }
+
+    // Our SETTINGS and the acknowledgements go out right away.
+    return Flush();
+}
+
+HTTP2_ERROR_CODE Connection::Error() const {
+    return error_;
+}
+
+Connection::CONNECTION_STATE Connection::State() const {
+    return state_;
+}
+
+int Connection::Fd() const {
+    return fd_;
+}
+
 uint32_t Connection::LastClientStreamId() {
     return streams_.size();
 }
@@ -96,13 +317,36 @@ lhttp2::Settings& Connection::Settings() {
     return settings_;
 }
 
+const lhttp2::Settings& Connection::PeerSettings() const {
+    return peer_settings_;
+}
+
 void Connection::SetSettings(lhttp2::Settings settings) {
     settings_ = settings;
-    hpack_table_.UpdateSize(settings_.header_table_size());
+    hpack_decoder_.UpdateSize(settings_.header_table_size());
+    hpack_decoder_.SetMaxHeaderListSize(settings_.max_header_list_size());
+    parser_.SetMaxFrameSize(settings_.max_frame_size());
 }
 
-void Connection::UseHuffman(bool use) {
-    use_huffman_ = use;
+void Connection::SetIndexingPolicy(hpack::IndexingPolicy* policy) {
+    hpack_encoder_.SetIndexingPolicy(policy);
+}
+
+const hpack::Table::Stats& Connection::HeaderStats() const {
+    return hpack_encoder_.GetStats();
+}
+
+void Connection::SetMemoryResource(MemoryResource* resource) {
+    resource_ = (resource != nullptr) ? resource : arena_;
+    parser_.SetMemoryResource(resource_);
+}
+
+void Connection::ReleaseMemory() {
+    // Slabs can only go back in bulk once the application has deleted every frame.
+    if(arena_->InUse() > 0) return;
+
+    arena_->Reset();
+    release_pending_ = false;
 }
 
 void Connection::SendPreface() {
@@ -121,4 +365,197 @@ bool Connection::RecvPreface() {
             return false;
 
     return true;
-}
\ No newline at end of file
+}
+
+// Reads CONTINUATION frames until the header block of headers is complete.
+bool Connection::RecvContinuation(HeadersFrame* headers) {
+    Frame* frame;
+
+    while(headers->has_end_headers_flag() == false) {
+        frame = NextFrame();
+        if(frame == nullptr) return false;
+
+        // Nothing may be interleaved with a header block (RFC 7540 6.10).
+        if(frame->type() != Frame::TYPE_CONTINUATION_FRAME || frame->stream_id() != headers->stream_id()) {
+            delete frame;
+            error_ = HTTP2_ERROR_PROTOCOL_ERROR;
+            return false;
+        }
+
+        headers->append_continuation(*(ContinuationFrame*)frame);
+        delete frame;
+    }
+
+    return true;
+}
+
+// Checks the preface, then parses every complete frame after read_start_.
+bool Connection::ParseReceived(std::vector<Frame*>& frames) {
+    uint32_t consumed;
+    size_t i;
+    bool parsed, ok = true;
+
+    if(state_ == STATE_PREFACE) {
+        if(read_end_ - read_start_ < PREFACE_LEN) return true;
+
+        if(memcmp(read_block_->Address() + read_start_, preface, PREFACE_LEN) != 0) {
+            error_ = HTTP2_ERROR_PROTOCOL_ERROR;
+            return false;
+        }
+
+        // The server connection preface is a SETTINGS frame as well.
+        read_start_ = read_start_ + PREFACE_LEN;
+        state_ = STATE_SETTINGS;
+        QueueSettings(false);
+    }
+
+    BufferSlice data(read_block_, read_start_, read_end_ - read_start_);
+    parsed = parser_.Parse(data, consumed, received_);
+    if(parsed == false) error_ = parser_.Error();
+    read_start_ = read_start_ + consumed;
+
+    // Frames completed before a connection error are still handed out.
+    for(i = 0; i < received_.size(); i++) {
+        if(ok) ok = DispatchReceived(received_[i], frames);
+        else delete received_[i];
+    }
+    received_.clear();
+
+    return parsed && ok;
+}
+
+// Takes the ownership of frame, it is appended to frames once it is complete.
+bool Connection::DispatchReceived(Frame* frame, std::vector<Frame*>& frames) {
+    // Nothing may be interleaved with a header block (RFC 7540 6.10).
+    if(pending_headers_ != nullptr) {
+        if(frame->type() != Frame::TYPE_CONTINUATION_FRAME || frame->stream_id() != pending_headers_->stream_id()) {
+            delete frame;
+            error_ = HTTP2_ERROR_PROTOCOL_ERROR;
+            return false;
+        }
+
+        pending_headers_->append_continuation(*(ContinuationFrame*)frame);
+        delete frame;
+        if(pending_headers_->has_end_headers_flag() == false) return true;
+
+        frame = pending_headers_;
+        pending_headers_ = nullptr;
+    }
+    else if(frame->type() == Frame::TYPE_HEADERS_FRAME && frame->has_flags(Frame::FLAG_END_HEADERS) == false) {
+        pending_headers_ = (HeadersFrame*)frame;
+        return true;
+    }
+
+    bool settings = frame->type() == Frame::TYPE_SETTINGS_FRAME && frame->has_flags(Frame::FLAG_ACK) == false;
+
+    // The peer's connection preface ends with its SETTINGS.
+    if(state_ == STATE_SETTINGS) {
+        if(settings == false) {
+            delete frame;
+            error_ = HTTP2_ERROR_PROTOCOL_ERROR;
+            return false;
+        }
+        state_ = STATE_OPEN;
+    }
+
+    ApplyReceived(frame);
+    frames.push_back(frame);
+    return true;
+}
+
+// Bookkeeping every received frame goes through before it is handed out, in either I/O mode.
+void Connection::ApplyReceived(const Frame* frame) {
+    UpdateSendWindow(frame);
+    if(frame->type() == Frame::TYPE_SETTINGS_FRAME && frame->has_flags(Frame::FLAG_ACK) == false) {
+        QueueSettings(true);
+        ((const SettingsFrame*)frame)->Apply(peer_settings_);
+
+        // Our encoder must fit into the peer's decoder table, and stays within 4096 octets.
+        uint32_t table_size = peer_settings_.header_table_size();
+        hpack_encoder_.UpdateSize(table_size < DYNAMIC_TABLE_SIZE_MAX ? table_size : DYNAMIC_TABLE_SIZE_MAX);
+    }
+
+    if(IsEndOfStream(frame)) release_pending_ = true;
+}
+
+void Connection::QueueSettings(bool ack) {
+    SettingsFrame settings_frame;
+
+    if(ack) settings_frame.set_ack_flag();
+    else settings_frame.set_settings(settings_);
+
+    write_queue_.Push(settings_frame.EncodeFrame(hpack_encoder_));
+}
+
+// Next parsed frame, reading from the socket until the parser completes one.
+Frame* Connection::NextFrame() {
+    while(received_next_ == received_.size()) {
+        received_.clear();
+        received_next_ = 0;
+        if(error_ != HTTP2_ERROR_NO_ERROR) return nullptr;
+        if(ReadFrames() == false) return nullptr;
+    }
+
+    return received_[received_next_++];
+}
+
+/*
+    One read into the receive block, then every complete frame in it is parsed
+    in place; payloads which outlive the frame (DATA) keep the block alive by
+    reference. A partial frame stays in the block, the next read appends to it.
+*/
+bool Connection::ReadFrames() {
+    ssize_t len;
+    uint32_t room, consumed;
+
+    if(PrepareReadBlock() == false) {
+        error_ = HTTP2_ERROR_INTERNAL_ERROR;
+        return false;
+    }
+
+    room = read_block_->Size() - read_end_;
+    len = ::read(fd_, read_block_->Address() + read_end_, room);
+    if(len < 0 && errno == EINTR) return true;
+    if(len <= 0) return false;
+
+    read_end_ = read_end_ + len;
+    if((uint32_t)len == room && read_size_ < CONNECTION_READ_SIZE_MAX) read_size_ = read_size_ * 2;
+
+    // Frames completed before a connection error are still handed out.
+    BufferSlice data(read_block_, read_start_, read_end_ - read_start_);
+    if(parser_.Parse(data, consumed, received_) == false) error_ = parser_.Error();
+    read_start_ = read_start_ + consumed;
+
+    return true;
+}
+
+// Makes room behind the unparsed bytes for the next read.
+bool Connection::PrepareReadBlock() {
+    uint32_t unparsed = read_end_ - read_start_, size = read_size_;
+
+    if(read_block_ != nullptr) {
+        // Nothing refers to a fully parsed block any more, it is simply reused.
+        if(unparsed == 0 && read_block_->Unique()) {
+            read_start_ = 0;
+            read_end_ = 0;
+        }
+
+        if(read_end_ < read_block_->Size() && read_start_ + parser_.Pending() <= read_block_->Size()) return true;
+    }
+
+    // The partial frame moves into a new block which is large enough to complete it.
+    while(size < parser_.Pending()) size = size * 2;
+
+    BufferBlock* block = BufferBlock::Create(size);
+    if(block == nullptr) return false;
+
+    if(read_block_ != nullptr) {
+        memcpy(block->Address(), read_block_->Address() + read_start_, unparsed);
+        read_block_->Unref();
+    }
+
+    read_block_ = block;
+    read_start_ = 0;
+    read_end_ = unparsed;
+    return true;
+}
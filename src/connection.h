@@ -2,12 +2,21 @@
 #define _LHTTP2_CONNECTION_H
 
 #include <vector>
+#include <unordered_map>
 #include <stdint.h>
+#include <sys/types.h>
 
 #include "stream.h"
 #include "frame.h"
+#include "frame_parser.h"
+#include "write_queue.h"
 #include "settings.h"
 #include "hpack/hpack.h"
+#include "memory/arena.h"
+
+// Receive blocks start small and double, while reads keep filling them, up to the maximum.
+#define CONNECTION_READ_SIZE_MIN 4096
+#define CONNECTION_READ_SIZE_MAX 65536
 
 namespace lhttp2 {
     class Connection {
@@ -17,13 +26,72 @@ namespace lhttp2 {
             ENDPOINT_SERVER,
         } ENDPOINT_TYPE;
 
-        Connection(int fd, ENDPOINT_TYPE type, lhttp2::Settings settings = lhttp2::Settings());
+        typedef enum _IO_MODE {
+            IO_BLOCKING,            // the constructor does the handshake, RecvFrame() blocks
+            IO_NON_BLOCKING,        // fd is O_NONBLOCK, Receive() drives the handshake
+        } IO_MODE;
+
+        typedef enum _CONNECTION_STATE {
+            STATE_PREFACE,          // server waiting for the client connection preface
+            STATE_SETTINGS,         // waiting for the first SETTINGS frame of the peer
+            STATE_OPEN,
+            STATE_CLOSED,
+        } CONNECTION_STATE;
+
+        Connection(int fd, ENDPOINT_TYPE type, lhttp2::Settings settings = lhttp2::Settings(), IO_MODE mode = IO_BLOCKING);
+        ~Connection();
+
+        Connection(const Connection& a) = delete;
+        void operator=(const Connection& a) = delete;
 
         uint32_t AllocateStream();
 
-        void SendFrame(uint32_t streamId, Frame* frame);
+        // Queues the frame, it goes out with the next Flush(), or right away once the
+        // queue reaches its flush threshold. false if the queue is full, a write failed
+        // or the frame could not be encoded.
+        bool SendFrame(uint32_t streamId, Frame* frame);
+        bool Flush();
+        void SetWriteLimits(uint32_t flush_threshold, uint32_t limit);
+
+        /*
+            Sends length octets of file_fd from offset as the DATA of a stream.
+            The frame headers are queued like any frame, the body goes from the
+            page cache to the socket with sendfile() once the queue is flushed,
+            never passing through user space. Frames are cut at the peer's
+            max_frame_size and only as many octets are queued as the connection
+            and stream flow-control windows allow.
+
+            Returns the octets queued, the rest is sent by calling again after
+            RecvFrame() took a WINDOW_UPDATE. END_STREAM is set on the frame with
+            the last octet of length if end_stream is true. -1 if the write queue
+            is full or a flush failed. file_fd must stay open until flushed.
+        */
+        int64_t SendFile(uint32_t streamId, int file_fd, off_t offset, uint64_t length, bool end_stream = true);
+
+        // Octets of DATA the flow-control windows let us send on the stream right now.
+        int64_t SendWindow(uint32_t streamId) const;
+
+        // Flushes queued frames first. A header block split over CONTINUATION frames is
+        // returned as a single HEADERS frame, SETTINGS are acknowledged right away.
+        // nullptr on a closed socket or a connection error, see Error().
         Frame* RecvFrame();
 
+        /*
+            Non-blocking receive. Reads until the socket would block, so it suits
+            edge-triggered readiness, and appends every frame completed to frames.
+            The preface and the first SETTINGS of the peer are checked on the way,
+            SETTINGS are acknowledged and CONTINUATION frames are merged as by
+            RecvFrame(). Returns false once the peer closed the connection or on
+            an error, frames received before are still appended. The caller owns
+            the frames.
+        */
+        bool Receive(std::vector<Frame*>& frames);
+
+        // Connection error detected while receiving, HTTP2_ERROR_NO_ERROR if none.
+        HTTP2_ERROR_CODE Error() const;
+        CONNECTION_STATE State() const;
+        int Fd() const;
+
         uint32_t LastClientStreamId();
         uint32_t LastServerStreamId();
         Stream::HTTP2_STREAM_STATUS StreamStatus(int streamId);
@@ -31,19 +99,65 @@ namespace lhttp2 {
         lhttp2::Settings& Settings();
         void SetSettings(lhttp2::Settings settings);
 
-        void UseHuffman(bool use);
+        // Defaults updated by every SETTINGS the peer sent, header blocks sent are split at its max_frame_size.
+        const lhttp2::Settings& PeerSettings() const;
+
+        // Header compression of the frames sent on this connection.
+        void SetIndexingPolicy(hpack::IndexingPolicy* policy);
+        const hpack::Table::Stats& HeaderStats() const;
+
+        /*
+            Received frames are allocated from resource. By default every
+            connection uses its own slab Arena, whose slabs are released in bulk
+            once no frame is alive any more: after a stream completed, and by an
+            EventLoop after every turn. Frames may outlive the connection, the
+            arena is kept until the last of them is deleted, but they must be
+            deleted on the thread which drives the connection. Payloads (DATA
+            BufferSlices) are allocated with malloc, so they may be released on
+            any thread.
+        */
+        void SetMemoryResource(MemoryResource* resource);
+        void ReleaseMemory();
 
     private:
         void SendPreface();
         bool RecvPreface();
+        Frame* NextFrame();
+        bool ReadFrames();
+        bool PrepareReadBlock();
+        bool RecvContinuation(HeadersFrame* headers);
+        bool ParseReceived(std::vector<Frame*>& frames);
+        bool DispatchReceived(Frame* frame, std::vector<Frame*>& frames);
+        void ApplyReceived(const Frame* frame);
+        void QueueSettings(bool ack);
+        void ConsumeSendWindow(uint32_t streamId, uint32_t len);
+        void UpdateSendWindow(const Frame* frame);
 
         int fd_;
         ENDPOINT_TYPE type_;
+        IO_MODE mode_;
+        CONNECTION_STATE state_ = STATE_OPEN;
         std::vector<Stream> streams_;
-        uint32_t window_size_ = 65535;
+        int64_t window_size_ = 65535;        // connection send window
+        std::unordered_map<uint32_t, int64_t> stream_windows_;    // send windows of the streams we may send on
+        uint32_t last_peer_stream_ = 0;     // highest stream opened by the peer
         lhttp2::Settings settings_;
-        hpack::Table hpack_table_;
-        bool use_huffman_ = true;
+        lhttp2::Settings peer_settings_;
+        hpack::Table hpack_encoder_;     // frames we send, mirrors the peer's decoder
+        hpack::Table hpack_decoder_;     // frames we receive
+        Arena* arena_ = new Arena();     // released, not deleted, frames may still use it
+        MemoryResource* resource_ = arena_;
+        bool release_pending_ = false;
+        FrameParser parser_{hpack_decoder_, resource_};
+        WriteQueue write_queue_;
+        std::vector<Frame*> received_;      // parsed, not yet returned by RecvFrame()
+        size_t received_next_ = 0;
+        BufferBlock* read_block_ = nullptr; // receive buffer, frames are parsed in place
+        uint32_t read_start_ = 0;           // first octet not parsed yet
+        uint32_t read_end_ = 0;             // end of the received octets
+        uint32_t read_size_ = CONNECTION_READ_SIZE_MIN;     // size of the next receive block
+        HeadersFrame* pending_headers_ = nullptr;   // header block waiting for CONTINUATION, non-blocking mode
+        HTTP2_ERROR_CODE error_ = HTTP2_ERROR_NO_ERROR;
     };
 
     class Server : public Connection {
@@ -0,0 +1,206 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "event_loop.h"
+
+using namespace lhttp2;
+
+ConnectionHandler::~ConnectionHandler() {
+}
+
+void ConnectionHandler::OnOpen(Connection& connection) {
+}
+
+void ConnectionHandler::OnClose(Connection& connection) {
+}
+
+EventLoop::EventLoop(ConnectionHandler* handler) : handler_(handler) {
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+}
+
+EventLoop::~EventLoop() {
+    for(size_t fd = 0; fd < connections_.size(); fd++) {
+        if(connections_[fd] != nullptr) Close(connections_[fd]);
+    }
+    DestroyClosed();
+
+    if(epoll_fd_ >= 0) ::close(epoll_fd_);
+}
+
+bool EventLoop::Ok() const {
+    return epoll_fd_ >= 0;
+}
+
+bool EventLoop::Listen(const int listen_fd, lhttp2::Settings settings) {
+    struct epoll_event event = {};
+
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd;
+
+    if(::fcntl(listen_fd, F_SETFL, ::fcntl(listen_fd, F_GETFL) | O_NONBLOCK) < 0) return false;
+    if(::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd, &event) < 0) return false;
+
+    listeners_[listen_fd] = settings;
+    return true;
+}
+
+Connection* EventLoop::Add(const int fd, Connection::ENDPOINT_TYPE type, lhttp2::Settings settings) {
+    struct epoll_event event = {};
+    int one = 1;
+
+    if(::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    // Frames are batched by the write queue already, Nagle would only add latency.
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    Connection* connection = new Connection(fd, type, settings, Connection::IO_NON_BLOCKING);
+
+    // Registering reports the current readiness too, so a client's preface goes out with the first turn.
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.fd = fd;
+
+    if(::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+        delete connection;
+        ::close(fd);
+        return nullptr;
+    }
+
+    if((size_t)fd >= connections_.size()) connections_.resize(fd + 1, nullptr);
+    connections_[fd] = connection;
+    count_++;
+
+    return connection;
+}
+
+void EventLoop::Close(Connection* connection) {
+    int fd = connection->Fd();
+
+    if((size_t)fd >= connections_.size() || connections_[fd] != connection) return;
+
+    connections_[fd] = nullptr;
+    count_--;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+
+    handler_->OnClose(*connection);
+    closed_.push_back(connection);
+}
+
+int EventLoop::RunOnce(const int timeout_ms) {
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+    int i, n, fd;
+
+    n = ::epoll_wait(epoll_fd_, events, EVENT_LOOP_MAX_EVENTS, timeout_ms);
+    if(n < 0) return (errno == EINTR) ? 0 : -1;
+
+    for(i = 0; i < n; i++) {
+        fd = events[i].data.fd;
+
+        if(listeners_.count(fd) > 0) Accept(fd);
+        else if((size_t)fd < connections_.size() && connections_[fd] != nullptr) HandleEvent(connections_[fd], events[i].events);
+    }
+
+    DestroyClosed();
+    return n;
+}
+
+void EventLoop::Run() {
+    stop_ = false;
+
+    while(stop_ == false) {
+        if(RunOnce(-1) < 0) break;
+    }
+}
+
+void EventLoop::Stop() {
+    stop_ = true;
+}
+
+size_t EventLoop::Count() const {
+    return count_;
+}
+
+void EventLoop::Accept(const int listen_fd) {
+    int fd;
+
+    for(;;) {
+        fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0) {
+            if(errno == EINTR || errno == ECONNABORTED) continue;
+
+            // The pending connection keeps the listener readable, it is not polled
+            // again before one of our descriptors is freed.
+            if(errno == EMFILE || errno == ENFILE) {
+                WatchListeners(0);
+                accept_paused_ = true;
+            }
+            return;
+        }
+
+        Add(fd, Connection::ENDPOINT_SERVER, listeners_[listen_fd]);
+    }
+}
+
+void EventLoop::HandleEvent(Connection* connection, const uint32_t events) {
+    Connection::CONNECTION_STATE state = connection->State();
+    int fd = connection->Fd();
+    bool alive = true;
+    size_t i;
+
+    if(events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        alive = connection->Receive(frames_);
+    }
+
+    if(state != Connection::STATE_OPEN && connection->State() == Connection::STATE_OPEN) {
+        handler_->OnOpen(*connection);
+    }
+
+    // A callback may close the connection, the frames after that are dropped.
+    for(i = 0; i < frames_.size(); i++) {
+        if(connections_[fd] == connection) handler_->OnFrame(*connection, frames_[i]);
+        delete frames_[i];
+    }
+    frames_.clear();
+
+    if(connections_[fd] != connection) return;
+
+    // Idle connections keep no slabs.
+    connection->ReleaseMemory();
+
+    // Flushes what the callbacks queued, and on EPOLLOUT what the socket took no room for before.
+    if(alive == false || connection->Flush() == false) Close(connection);
+}
+
+void EventLoop::DestroyClosed() {
+    int fd;
+
+    for(size_t i = 0; i < closed_.size(); i++) {
+        fd = closed_[i]->Fd();
+        delete closed_[i];
+        ::close(fd);
+    }
+
+    if(accept_paused_ && closed_.empty() == false) {
+        WatchListeners(EPOLLIN);
+        accept_paused_ = false;
+    }
+    closed_.clear();
+}
+
+void EventLoop::WatchListeners(const uint32_t events) {
+    struct epoll_event event = {};
+
+    for(auto& listener : listeners_) {
+        event.events = events;
+        event.data.fd = listener.first;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, listener.first, &event);
+    }
+}
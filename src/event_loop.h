@@ -0,0 +1,98 @@
+#ifndef _LHTTP2_EVENT_LOOP_H_
+#define _LHTTP2_EVENT_LOOP_H_
+
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+#include "connection.h"
+#include "frame.h"
+#include "settings.h"
+
+#define EVENT_LOOP_MAX_EVENTS 256       // readiness events taken per epoll_wait()
+
+namespace lhttp2 {
+    /*
+        ### Connection handler ###
+
+        Callbacks of an EventLoop, all of them run on the thread of the loop.
+        A callback may send on the connection, the frames it queues are flushed
+        when the loop is done with the connection, or close it.
+    */
+    class ConnectionHandler {
+    public:
+        virtual ~ConnectionHandler();
+
+        // Both connection prefaces went through, the peer's SETTINGS are known.
+        virtual void OnOpen(Connection& connection);
+
+        // frame is deleted once the callback returns.
+        virtual void OnFrame(Connection& connection, Frame* frame) = 0;
+
+        // Last call for the connection, Error() tells the reason if there is one.
+        virtual void OnClose(Connection& connection);
+    };
+
+    /*
+        ### Event loop ###
+
+        Drives many non-blocking Connections from a single thread. Sockets are
+        registered with epoll edge-triggered for input and output; on readiness
+        a connection reads until the socket would block, advances its handshake,
+        hands every frame to the handler and flushes its write queue. Listening
+        sockets are level-triggered. When the descriptor table is full they are
+        taken off input until the loop closes one of its connections, instead
+        of waking every turn for a connection accept() can not take.
+
+        The loop owns its connections and their sockets. A connection closed by
+        the peer, by an error or by Close() is removed from epoll at once, then
+        destroyed and its socket closed at the end of the turn.
+    */
+    class EventLoop {
+    public:
+        EventLoop(ConnectionHandler* handler);
+        ~EventLoop();
+
+        EventLoop(const EventLoop& a) = delete;
+        void operator=(const EventLoop& a) = delete;
+
+        // Whether the epoll instance could be created.
+        bool Ok() const;
+
+        // Accepts server connections from a bound, listening socket.
+        bool Listen(const int listen_fd, lhttp2::Settings settings = lhttp2::Settings());
+
+        // Takes over a connected or connecting socket. nullptr, with fd closed, on failure.
+        Connection* Add(const int fd, Connection::ENDPOINT_TYPE type, lhttp2::Settings settings = lhttp2::Settings());
+
+        void Close(Connection* connection);
+
+        // Handles the events which arrive within timeout_ms (-1 waits), returns their number or -1.
+        int RunOnce(const int timeout_ms = -1);
+
+        // Turns until Stop() is called, typically from a callback.
+        void Run();
+        void Stop();
+
+        // Open connections, handshakes in progress included.
+        size_t Count() const;
+
+    private:
+        void Accept(const int listen_fd);
+        void HandleEvent(Connection* connection, const uint32_t events);
+        void DestroyClosed();
+        void WatchListeners(const uint32_t events);
+
+        int epoll_fd_;
+        ConnectionHandler* handler_;
+        std::vector<Connection*> connections_;      // indexed by socket
+        std::unordered_map<int, lhttp2::Settings> listeners_;
+        std::vector<Connection*> closed_;           // destroyed at the end of the turn
+        std::vector<Frame*> frames_;                // frames of the connection being handled
+        size_t count_ = 0;
+        bool accept_paused_ = false;                // listeners are off input, the descriptor table is full
+        bool stop_ = false;
+    };
+};
+
+#endif
@@ -1,18 +1,92 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
-#include <signal.h>
+#include <errno.h>
+#include <new>
+#include <cstring>
 
 #include "frame.h"
+#include "frame_view.h"
+#include "write_queue.h"
+#include "buffer/buffer_pool.h"
 
 using namespace lhttp2;
 
+// Padding octets are always zero, so every padded frame borrows them from here.
+static const char padding[256] = {0};
+
+static int WriteChain(const int fd, const BufferChain& chain) {
+    unsigned int total = chain.Length(), sent = 0;
+    ssize_t len;
+
+    while(sent < total) {
+        len = WriteQueue::Write(fd, chain, sent);
+        if(len < 0) {
+            if(errno == EINTR) continue;
+            return (sent > 0) ? sent : -1;
+        }
+        sent = sent + len;
+    }
+
+    return sent;
+}
+
+// Blocking read of exactly len bytes, short reads are continued.
+static bool ReadFull(const int fd, char* buff, const uint32_t len) {
+    uint32_t received = 0;
+    ssize_t n;
+
+    while(received < len) {
+        n = ::read(fd, buff + received, len - received);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        received = received + n;
+    }
+
+    return true;
+}
+
+// Prefix stored in front of every frame allocation.
+union FrameAllocationHeader {
+    struct {
+        MemoryResource* resource;
+        size_t size;
+    } info;
+    std::max_align_t align;
+};
+
 /*
     Implementation of frame header
 */
 Frame::~Frame() {
 }
 
+void* Frame::operator new(size_t size) {
+    return operator new(size, NewDeleteResource());
+}
+
+void* Frame::operator new(size_t size, MemoryResource* resource) {
+    if(resource == nullptr) resource = NewDeleteResource();
+
+    FrameAllocationHeader* header = (FrameAllocationHeader *)resource->Allocate(sizeof(FrameAllocationHeader) + size);
+    if(header == nullptr) throw std::bad_alloc();
+
+    header->info.resource = resource;
+    header->info.size = sizeof(FrameAllocationHeader) + size;
+    return header + 1;
+}
+
+void Frame::operator delete(void* p) {
+    if(p == nullptr) return;
+
+    FrameAllocationHeader* header = (FrameAllocationHeader *)p - 1;
+    header->info.resource->Deallocate(header, header->info.size);
+}
+
+void Frame::operator delete(void* p, MemoryResource* resource) {
+    operator delete(p);
+}
+
 const uint32_t Frame::length() const {
     return length_;
 }
@@ -50,67 +124,85 @@ void Frame::set_stream_id(uint32_t streamId) {
 }
 
 Frame* Frame::RecvFrame(const int fd, hpack::Table& hpack_table, bool debug) {
+    return RecvFrame(fd, hpack_table, NewDeleteResource(), debug);
+}
+
+Frame* Frame::RecvFrame(const int fd, hpack::Table& hpack_table, MemoryResource* resource, bool debug) {
     if(fd < 0) {
         return nullptr;
     }
 
-    Frame *frame;
-    char header_buff[9];
-    uint8_t flags;
-    uint32_t length, stream_id;
-    bool reserved;
-    FRAME_TYPE type;
+    char header_buff[FRAME_HEADER_LENGTH];
+    uint32_t length;
 
-    if(::read(fd, header_buff, 9) != 9) {
+    if(ReadFull(fd, header_buff, FRAME_HEADER_LENGTH) == false) {
         return nullptr;
     }
 
-    length = (uint32_t)header_buff[0] << 16 | \
-             (uint32_t)header_buff[1] << 8 | \
-             (uint32_t)header_buff[2];
+    ByteReader header(header_buff, FRAME_HEADER_LENGTH);
+    length = header.U24();
 
-    type = (FRAME_TYPE)header_buff[3];
-    flags = (uint8_t)header_buff[4];
-    reserved = ((header_buff[5] & 0x80) == 0x80);
-
-    stream_id = (uint32_t)(header_buff[5] & 0x7F) << 24 | \
-                (uint32_t)header_buff[6] << 16 | \
-                (uint32_t)header_buff[7] << 8 | \
-                (uint32_t)header_buff[8];
+    // Payloads may outlive the resource and be released on any thread, they come from malloc.
+    BufferBlock* block = BufferBlock::Create(length);
+    if(block == nullptr) {
+        return nullptr;
+    }
 
-    if(type > 0x09) {
+    if(ReadFull(fd, block->Address(), length) == false) {
+        block->Unref();
         return nullptr;
     }
 
-    char* payload_buff = new char[length];
+    if(debug) {
+        Buffer::PrintBuffer(header_buff, FRAME_HEADER_LENGTH);
+        Buffer::PrintBuffer(block->Address(), length);
+    }
+
+    // The payload slice keeps the block alive for frames which hold on to it (DATA).
+    BufferSlice payload(block, 0, length);
+    block->Unref();
+
+    return Decode(header_buff, payload, hpack_table, resource);
+}
 
-    if(::read(fd, payload_buff, length) != length) {
-        delete[] payload_buff;
+Frame* Frame::Decode(const char* header_buff, const BufferSlice& payload, hpack::Table& hpack_table, MemoryResource* resource) {
+    Frame *frame;
+    uint8_t flags;
+    uint32_t length, stream_id;
+    bool reserved;
+    FRAME_TYPE type;
+
+    ByteReader header(header_buff, FRAME_HEADER_LENGTH);
+    length = header.U24();
+    type = (FRAME_TYPE)header.U8();
+    flags = header.U8();
+    stream_id = header.U31(reserved);
+
+    if(length != payload.Length()) {
         return nullptr;
     }
 
     if(type == TYPE_DATA_FRAME)
-        frame = new DataFrame();
+        frame = new (resource) DataFrame();
     else if(type == TYPE_HEADERS_FRAME)
-        frame = new HeadersFrame();
+        frame = new (resource) HeadersFrame();
     else if(type == TYPE_PRIORITY_FRAME)
-        frame = new PriorityFrame();
+        frame = new (resource) PriorityFrame();
     else if(type == TYPE_RST_STREAM_FRAME)
-        frame = new RSTStreamFrame();
+        frame = new (resource) RSTStreamFrame();
     else if(type == TYPE_SETTINGS_FRAME)
-        frame = new SettingsFrame();
+        frame = new (resource) SettingsFrame();
     else if(type == TYPE_PUSH_PROMISE_FRAME)
-        frame = new PushPromisFrame();
+        frame = new (resource) PushPromisFrame();
     else if(type == TYPE_PING_FRAME)
-        frame = new PingFrame();
+        frame = new (resource) PingFrame();
     else if(type == TYPE_GOAWAY_FRAME)
-        frame = new GoawayFrame();
+        frame = new (resource) GoawayFrame();
     else if(type == TYPE_WINDOW_UPDATE_FRAME)
-        frame = new WindowUpdateFrame();
+        frame = new (resource) WindowUpdateFrame();
     else if(type == TYPE_CONTINUATION_FRAME)
-        frame = new ContinuationFrame();
+        frame = new (resource) ContinuationFrame();
     else {
-        delete[] payload_buff;
         return nullptr;
     }
 
@@ -120,27 +212,20 @@ Frame* Frame::RecvFrame(const int fd, hpack::Table& hpack_table, bool debug) {
     frame->reserved_ = reserved;
     frame->stream_id_ = stream_id;
 
-    if(debug) {
-        Buffer::PrintBuffer(header_buff, 9);
-        Buffer::PrintBuffer(payload_buff, length);
+    if(frame->DecodeFramePayload(payload, hpack_table) == false) {
+        delete frame;
+        return nullptr;
     }
 
-    frame->DecodeFramePayload((const char *)payload_buff, frame->length_, hpack_table);
-
-    delete[] payload_buff;
-
     return frame;
 }
 
 int Frame::SendFrame(const int fd, Frame* frame, hpack::Table& hpack_table, bool debug) {
-    Buffer *stream = frame->EncodeFrame(hpack_table);
-    if(debug == true) stream->Print();
+    BufferChain stream = frame->EncodeFrame(hpack_table);
+    if(stream.Length() == 0) return -1;
+    if(debug == true) stream.Print();
 
-    signal(SIGPIPE, SIG_IGN);
-    int len = ::send(fd, stream->Address(), stream->Length(), 0);
-
-    delete stream;
-    return len;
+    return WriteChain(fd, stream);
 }
 
 const std::string Frame::GetFrameTypeName(FRAME_TYPE type) {
@@ -160,19 +245,94 @@ const std::string Frame::GetFrameTypeName(FRAME_TYPE type) {
     return "UNKNOWN";
 }
 
-Buffer* Frame::EncodeFrame(hpack::Table& hpack_table) {
-    Buffer* payloadBuffer = EncodeFramePayload(hpack_table);
-    Buffer* headerBuffer = new Buffer(9 + payloadBuffer->Length());
+bool Frame::DecodeFramePayload(const BufferSlice& payload, hpack::Table& hpack_table) {
+    return DecodeFramePayload(payload.Address(), payload.Length(), hpack_table);
+}
+
+static void AppendFrameHeader(BufferChain& chain, uint32_t length, uint8_t type, uint8_t flags, uint32_t stream_id, bool reserved) {
+    Buffer* headerBuffer = BufferPool::Acquire(FRAME_HEADER_LENGTH);
+
+    ByteWriter header(*headerBuffer, FRAME_HEADER_LENGTH);
+    header.U24(length);
+    header.U8(type);
+    header.U8(flags);
+    header.U31(stream_id, reserved);
+
+    chain.Append(headerBuffer);
+}
+
+BufferChain Frame::EncodeFrame(hpack::Table& hpack_table, const uint32_t max_frame_size) {
+    BufferChain payload = EncodeFramePayload(hpack_table);
+
+    if(encode_failed_) {
+        encode_failed_ = false;
+        return BufferChain();
+    }
+
+    if(payload.Length() > max_frame_size && (type_ == TYPE_HEADERS_FRAME || type_ == TYPE_PUSH_PROMISE_FRAME)) {
+        return EncodeHeaderBlockFrames(payload, max_frame_size);
+    }
+
+    BufferChain chain;
+    AppendFrameHeader(chain, payload.Length(), type_, flags_, stream_id_, reserved_);
+    chain.Append(std::move(payload));
+
+    return chain;
+}
+
+BufferChain Frame::EncodeHeaderBlockFrames(const BufferChain& payload, const uint32_t max_frame_size) {
+    uint32_t i, offset = 0, prefix_len, fragment_len, pad_length, n;
+    uint8_t flags;
+
+    // The payload is gathered once, every frame references its part of the copy.
+    BufferBlock* block = BufferBlock::Create(payload.Length());
+
+    // An empty chain fails the send like an encode error does.
+    if(block == nullptr) return BufferChain();
+
+    for(i = 0; i < payload.Count(); i++) {
+        memcpy(block->Address() + offset, payload[i].base, payload[i].len);
+        offset = offset + payload[i].len;
+    }
+
+    BufferSlice all(block, 0, payload.Length());
+    block->Unref();
+
+    if(type_ == TYPE_HEADERS_FRAME) {
+        HeadersView view(all.Address(), all.Length(), flags_);
+        prefix_len = view.header_block_fragment() - all.Address();
+        fragment_len = view.header_block_fragment_length();
+        pad_length = view.pad_length();
+    }
+    else {
+        PushPromiseView view(all.Address(), all.Length(), flags_);
+        prefix_len = view.header_block_fragment() - all.Address();
+        fragment_len = view.header_block_fragment_length();
+        pad_length = view.pad_length();
+    }
+
+    // The first frame keeps the prefix, the padding and every flag but END_HEADERS.
+    n = (prefix_len + pad_length < max_frame_size) ? max_frame_size - prefix_len - pad_length : 0;
+    if(n > fragment_len) n = fragment_len;
+
+    BufferChain chain;
+    AppendFrameHeader(chain, prefix_len + n + pad_length, type_, flags_ & ~FLAG_END_HEADERS, stream_id_, reserved_);
+    chain.Append(all.Slice(0, prefix_len + n));
+    if(pad_length > 0) chain.Append(padding, pad_length);
 
-    headerBuffer->SetValue(payloadBuffer->Length(), 3, 0);
-    headerBuffer->SetValue(type_, 1, 3);
-    headerBuffer->SetValue(flags_, 1, 4);
-    headerBuffer->SetValue((reserved_ << 7) | (stream_id_ & 0x7FFFFFFF), 4, 5);
+    offset = prefix_len + n;
+    while(offset < prefix_len + fragment_len) {
+        n = prefix_len + fragment_len - offset;
+        if(n > max_frame_size) n = max_frame_size;
 
-    headerBuffer->Append(*payloadBuffer);
-    delete payloadBuffer;
+        flags = (offset + n == prefix_len + fragment_len) ? (flags_ & FLAG_END_HEADERS) : 0;
+        AppendFrameHeader(chain, n, TYPE_CONTINUATION_FRAME, flags, stream_id_, false);
+        chain.Append(all.Slice(offset, n));
 
-    return headerBuffer;
+        offset = offset + n;
+    }
+
+    return chain;
 }
 
 /*
@@ -182,14 +342,22 @@ DataFrame::DataFrame() {
     type_ = TYPE_DATA_FRAME;
 }
 
-DataFrame::DataFrame(Buffer data, uint8_t pad_length) {
-    DataFrame();
+DataFrame::DataFrame(Buffer data, uint8_t pad_length) : DataFrame() {
+    pad_length_ = pad_length;
+    if(pad_length_ > 0) set_flags(FLAG_PADDED);
+    else clear_flags(FLAG_PADDED);
+
+    data_ = BufferSlice(data);
 
+    UpdateLength();
+}
+
+DataFrame::DataFrame(BufferSlice data, uint8_t pad_length) : DataFrame() {
     pad_length_ = pad_length;
     if(pad_length_ > 0) set_flags(FLAG_PADDED);
     else clear_flags(FLAG_PADDED);
 
-    data_ = data;
+    data_ = std::move(data);
 
     UpdateLength();
 }
@@ -201,7 +369,7 @@ const uint8_t DataFrame::pad_length() const {
     return pad_length_;
 }
 
-const Buffer& DataFrame::data() const {
+const BufferSlice& DataFrame::data() const {
     return data_;
 }
 
@@ -210,6 +378,11 @@ void DataFrame::set_pad_length(uint8_t pad_length) {
 }
 
 void DataFrame::set_data(Buffer& data) {
+    data_ = BufferSlice(data);
+    UpdateLength();
+}
+
+void DataFrame::set_data(const BufferSlice& data) {
     data_ = data;
     UpdateLength();
 }
@@ -240,29 +413,36 @@ void DataFrame::clear_padded_flag() {
     UpdateLength();
 }
 
-Buffer* DataFrame::EncodeFramePayload(hpack::Table& hpack_table) {
-    Buffer *stream = new Buffer(length_);
+BufferChain DataFrame::EncodeFramePayload(hpack::Table& hpack_table) {
+    BufferChain stream;
 
+    // The data is referenced, not copied, and stays valid after the frame is gone.
     if(has_padded_flag()) {
-        stream->Set(pad_length_, 0);
-        stream->Append(data_);
+        Buffer *prefix = BufferPool::Acquire(1);
+        ByteWriter writer(*prefix, 1);
+        writer.U8(pad_length_);
+
+        stream.Append(prefix);
+        stream.Append(data_);
+        stream.Append(padding, pad_length_);
     }
     else {
-        stream->Append(data_);
+        stream.Append(data_);
     }
 
     return stream;
 }
 
 bool DataFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    int idx = 0;
+    return DecodeFramePayload(BufferSlice(buff, len), hpack_table);
+}
 
-    if(has_padded_flag()) {
-        pad_length_ = buff[idx];
-        idx = idx + 1;
-    }
+bool DataFrame::DecodeFramePayload(const BufferSlice& payload, hpack::Table& hpack_table) {
+    DataView view(payload.Address(), payload.Length(), flags_);
+    if(view.Valid() == false) return false;
 
-    data_ = Buffer(buff + idx, len - pad_length_ - idx);
+    pad_length_ = view.pad_length();
+    data_ = payload.Slice(view.data() - view.payload(), view.data_length());
     UpdateLength();
 
     return true;
@@ -282,9 +462,7 @@ HeadersFrame::HeadersFrame() {
     type_ = TYPE_HEADERS_FRAME;
 }
 
-HeadersFrame::HeadersFrame(std::vector<hpack::HeaderFieldRepresentation> header_list, hpack::Table& hpack_table, uint8_t pad_length) {
-    HeadersFrame();
-
+HeadersFrame::HeadersFrame(std::vector<hpack::HeaderFieldRepresentation> header_list, hpack::Table& hpack_table, uint8_t pad_length) : HeadersFrame() {
     pad_length_ = pad_length;
     if(pad_length_ > 0) set_flags(FLAG_PADDED);
     else clear_flags(FLAG_PADDED);
@@ -295,9 +473,7 @@ HeadersFrame::HeadersFrame(std::vector<hpack::HeaderFieldRepresentation> header_
     update_header_block_fragment(hpack_table);
 }
 
-HeadersFrame::HeadersFrame(std::vector<hpack::HeaderFieldRepresentation> header_list, hpack::Table& hpack_table, bool exclusive, uint32_t stream_dependency, uint8_t weight, uint8_t pad_length) {
-    HeadersFrame();
-
+HeadersFrame::HeadersFrame(std::vector<hpack::HeaderFieldRepresentation> header_list, hpack::Table& hpack_table, bool exclusive, uint32_t stream_dependency, uint8_t weight, uint8_t pad_length) : HeadersFrame() {
     pad_length_ = pad_length;
     if(pad_length_ > 0) set_flags(FLAG_PADDED);
     else clear_flags(FLAG_PADDED);
@@ -360,7 +536,7 @@ void HeadersFrame::set_header_list(std::vector<hpack::HeaderFieldRepresentation>
 }
 
 void HeadersFrame::update_header_block_fragment(hpack::Table& hpack_table) {
-    hpack_table.Encode(header_, header_list_, false);
+    header_.Clear();
     UpdateLength();
 }
 
@@ -416,47 +592,56 @@ void HeadersFrame::clear_priority_flag() {
     UpdateLength();
 }
 
-Buffer* HeadersFrame::EncodeFramePayload(hpack::Table& hpack_table) {
-    update_header_block_fragment(hpack_table);
-    int idx = 0;
-    Buffer *stream = new Buffer(length_);
+BufferChain HeadersFrame::EncodeFramePayload(hpack::Table& hpack_table) {
+    BufferChain stream;
+    uint32_t prefix_len = (has_padded_flag() ? 1 : 0) + (has_priority_flag() ? 5 : 0);
+    uint32_t block_max = hpack::Table::MaxEncodedLength(header_list_), block_len = 0;
+
+    // The prefix and the header block share one Buffer, the block is encoded in place behind the prefix.
+    Buffer *payload = BufferPool::Acquire(prefix_len + block_max);
+    ByteWriter writer(*payload, prefix_len + block_max);
 
     if(has_padded_flag()) {
-        stream->Set(pad_length_, idx);
-        idx = idx + 1;
+        writer.U8(pad_length_);
     }
 
     if(has_priority_flag()) {
-        stream->SetValue((exclusive_ << 7) | (stream_dependency_ & 0x7FFFFFFF), 4, idx);
-        stream->Set(weight_, idx + 4);
-        idx = idx + 5;
+        writer.U31(stream_dependency_, exclusive_);
+        writer.U8(weight_);
+    }
+
+    if(block_max > 0 && hpack_table.Encode(&(*payload)[prefix_len], block_max, block_len, header_list_.data(), header_list_.size(), true) == false) {
+        BufferPool::Release(payload);
+        encode_failed_ = true;
+        return stream;
     }
+    payload->Resize(prefix_len + block_len);
+    length_ = prefix_len + block_len + (has_padded_flag() ? pad_length_ : 0);
 
-    stream->Append(header_);
+    stream.Append(payload);
+
+    if(has_padded_flag())
+        stream.Append(padding, pad_length_);
 
     return stream;
 }
 
 bool HeadersFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    int idx = 0;
-
-    if(has_padded_flag()) {
-        pad_length_ = buff[idx];
-        idx = idx + 1;
-    }
+    HeadersView view(buff, len, flags_);
+    if(view.Valid() == false) return false;
 
+    pad_length_ = view.pad_length();
     if(has_priority_flag()) {
-        exclusive_ = ((buff[idx] & 0x80) == 0x80);
-        stream_dependency_ = (uint32_t)(buff[idx] & 0x7F) << 24 | \
-                            (uint32_t)buff[idx + 1] << 16 | \
-                            (uint32_t)buff[idx + 2] << 8 | \
-                            (uint32_t)buff[idx + 3];
-        weight_ = buff[idx + 4];
-        idx = idx + 5;
+        exclusive_ = view.exclusive();
+        stream_dependency_ = view.stream_dependency();
+        weight_ = view.weight();
     }
 
-    header_ = Buffer(buff + idx, len - pad_length_ - idx);
-    if(hpack_table.Decode(header_list_, header_) == false) {
+    header_ = Buffer(view.header_block_fragment(), view.header_block_fragment_length());
+
+    // Without END_HEADERS the fields cut by the fragment end arrive with the CONTINUATION frames.
+    hpack::Table::DECODE_STATUS status = hpack_table.DecodeFragment(header_list_, header_.Address(), header_.Length(), has_end_headers_flag());
+    if(status != hpack::Table::DECODE_COMPLETE && status != hpack::Table::DECODE_INCOMPLETE) {
         return false;
     }
 
@@ -465,9 +650,22 @@ bool HeadersFrame::DecodeFramePayload(const char* buff, const int len, hpack::Ta
     return true;
 }
 
+void HeadersFrame::append_continuation(const ContinuationFrame& continuation) {
+    const std::vector<hpack::HeaderFieldRepresentation>& header_list = continuation.header_list();
+
+    header_list_.insert(header_list_.end(), header_list.begin(), header_list.end());
+    header_.Append(continuation.header_block_fragment());
+    if(continuation.has_flags(FLAG_END_HEADERS)) set_flags(FLAG_END_HEADERS);
+
+    UpdateLength();
+}
+
 void HeadersFrame::UpdateLength() {
     length_ = header_.Length();
 
+    // Not encoded yet, the block takes at most this much.
+    if(header_.Length() == 0) length_ = hpack::Table::MaxEncodedLength(header_list_);
+
     if(has_padded_flag())
         length_ = length_ + pad_length_ + 1;
 
@@ -483,8 +681,7 @@ PriorityFrame::PriorityFrame() {
     length_ = 5;
 }
 
-PriorityFrame::PriorityFrame(bool exclusive, uint32_t stream_dependency, uint8_t weight) {
-    PriorityFrame();
+PriorityFrame::PriorityFrame(bool exclusive, uint32_t stream_dependency, uint8_t weight) : PriorityFrame() {
     exclusive_ = exclusive;
     stream_dependency_ = stream_dependency;
     weight_ = weight;
@@ -517,24 +714,25 @@ void PriorityFrame::set_weight(uint8_t weight) {
     weight_ = weight;
 }
 
-Buffer* PriorityFrame::EncodeFramePayload(hpack::Table& hpack_table) {
-    Buffer *stream = new Buffer(40);
+BufferChain PriorityFrame::EncodeFramePayload(hpack::Table& hpack_table) {
+    Buffer *payload = BufferPool::Acquire(5);
 
-    stream->SetValue((exclusive_ << 7) | (stream_dependency_ & 0x7FFFFFFF), 4, 0);
-    stream->Set(weight_, 4);
+    ByteWriter writer(*payload, 5);
+    writer.U31(stream_dependency_, exclusive_);
+    writer.U8(weight_);
 
+    BufferChain stream;
+    stream.Append(payload);
     return stream;
 }
 
 bool PriorityFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    if(len != 5) return false;
+    PriorityView view(buff, len, flags_);
+    if(view.Valid() == false) return false;
 
-    exclusive_ = ((buff[0] & 0x80) == 0x80);
-    stream_dependency_ = (uint32_t)(buff[0] & 0x7F) << 24 | \
-                        (uint32_t)buff[1] << 16 | \
-                        (uint32_t)buff[2] << 8 | \
-                        (uint32_t)buff[3];
-    weight_ = buff[4];
+    exclusive_ = view.exclusive();
+    stream_dependency_ = view.stream_dependency();
+    weight_ = view.weight();
 
     UpdateLength();
 
@@ -553,8 +751,7 @@ RSTStreamFrame::RSTStreamFrame() {
     length_ = 4;
 }
 
-RSTStreamFrame::RSTStreamFrame(uint32_t error_code) {
-    RSTStreamFrame();
+RSTStreamFrame::RSTStreamFrame(uint32_t error_code) : RSTStreamFrame() {
     error_code_ = error_code;
 }
 
@@ -569,23 +766,24 @@ void RSTStreamFrame::set_error_code(uint32_t error_code) {
     error_code_ = error_code;
 }
 
-Buffer* RSTStreamFrame::EncodeFramePayload(hpack::Table& hpack_table) {
-    Buffer *stream = new Buffer(32);
+BufferChain RSTStreamFrame::EncodeFramePayload(hpack::Table& hpack_table) {
+    Buffer *payload = BufferPool::Acquire(4);
 
-    stream->SetValue(error_code_, 4, 0);
+    ByteWriter writer(*payload, 4);
+    writer.U32(error_code_);
 
     UpdateLength();
 
+    BufferChain stream;
+    stream.Append(payload);
     return stream;
 }
 
 bool RSTStreamFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    if(len != 4) return false;
+    RSTStreamView view(buff, len, flags_);
+    if(view.Valid() == false) return false;
 
-    error_code_ = (uint32_t)buff[0] << 24 | \
-                 (uint32_t)buff[1] << 16 | \
-                 (uint32_t)buff[2] << 8 | \
-                 (uint32_t)buff[3];
+    error_code_ = view.error_code();
 
     return true;
 }
@@ -601,9 +799,9 @@ SettingsFrame::SettingsFrame() {
     type_ = TYPE_SETTINGS_FRAME;
 }
 
-SettingsFrame::SettingsFrame(lhttp2::Settings settings) {
-    SettingsFrame();
+SettingsFrame::SettingsFrame(lhttp2::Settings settings) : SettingsFrame() {
     settings_ = settings;
+    parameters_ = ChangedParameters(settings_);
     UpdateLength();
 }
 
@@ -616,6 +814,7 @@ const lhttp2::Settings& SettingsFrame::settings() const {
 
 void SettingsFrame::set_settings(lhttp2::Settings& settings) {
     settings_ = settings;
+    parameters_ = ChangedParameters(settings_);
     UpdateLength();
 }
 
@@ -633,103 +832,123 @@ void SettingsFrame::clear_ack_flag() {
     UpdateLength();
 }
 
-Buffer* SettingsFrame::EncodeFramePayload(hpack::Table& hpack_table) {
-    if(has_ack_flag() == true || length_ == 0) {
-        return new Buffer((unsigned int)0);
-    }
-
-    int idx = 0;
-    Buffer *stream = new Buffer(length_);
-
-    if(settings_.header_table_size() != 0x1000) {
-        stream->SetValue(0x0001, 2, idx);
-        stream->SetValue(settings_.header_table_size(), 4, idx + 2);
-        idx = idx + 6;
-    }
+bool SettingsFrame::has_parameter(SETTINGS_PARAMETERS id) const {
+    return (parameters_ & (1 << id)) != 0;
+}
 
-    if(settings_.enable_push() != true) {
-        stream->SetValue(0x0002, 2, idx);
-        stream->SetValue(settings_.enable_push(), 4, idx + 2);
-        idx = idx + 6;
-    }
+void SettingsFrame::Apply(lhttp2::Settings& settings) const {
+    ApplySettings(settings_, parameters_, settings);
+}
 
-    if(settings_.max_concurrent_stream() != UINT32_MAX) {
-        stream->SetValue(0x0003, 2, idx);
-        stream->SetValue(settings_.max_concurrent_stream(), 4, idx + 2);
-        idx = idx + 6;
-    }
+BufferChain SettingsFrame::EncodeFramePayload(hpack::Table& hpack_table) {
+    BufferChain chain;
 
-    if(settings_.initial_window_size() != 0xFFFF) {
-        stream->SetValue(0x0004, 2, idx);
-        stream->SetValue(settings_.initial_window_size(), 4, idx + 2);
-        idx = idx + 6;
+    if(has_ack_flag() == true || length_ == 0) {
+        return chain;
     }
 
-    if(settings_.max_frame_size() != 0x4000) {
-        stream->SetValue(0x0005, 2, idx);
-        stream->SetValue(settings_.max_frame_size(), 4, idx + 2);
-        idx = idx + 6;
-    }
+    Buffer *stream = BufferPool::Acquire(length_);
+    ByteWriter writer(*stream, length_);
+    EncodeSettings(settings_, writer);
 
-    if(settings_.max_header_list_size() != UINT32_MAX) {
-        stream->SetValue(0x0006, 2, idx);
-        stream->SetValue(settings_.max_header_list_size(), 4, idx + 2);
-        idx = idx + 6;
-    }
-    
-    return stream;
+    chain.Append(stream);
+    return chain;
 }
 
 bool SettingsFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    if(len % 6 != 0) return false;
-
-    int i, set_cnt = len / 6;
-    uint32_t id, val;
-    lhttp2::Settings settings;
-
-    for(i = 0; i < set_cnt; i++) {
-        id = (uint32_t)buff[i * 6] << 8 | \
-             (uint32_t)buff[i * 6 + 1];
-
-        val = (uint32_t)buff[i * 6 + 2] << 24 | \
-              (uint32_t)buff[i * 6 + 3] << 16 | \
-              (uint32_t)buff[i * 6 + 4] << 8 | \
-              (uint32_t)buff[i * 6 + 5];
-
-        if(id == SETTINGS_HEADER_TABLE_SIZE) settings.set_header_table_size(val);
-        else if(id == SETTINGS_ENABLE_PUSH) settings.set_enable_push(val);
-        else if(id == SETTINGS_MAX_CONCURRENT_STREAMS) settings.set_max_concurrent_stream(val);
-        else if(id == SETTINGS_INITIAL_WINDOW_SIZE) settings.set_initial_window_size(val);
-        else if(id == SETTINGS_MAX_FRAME_SIZE) {
-            if(val < 0x4000) val = 0x4000;
-            if(val > 0xFFFFFF) val = 0xFFFFFF;
-            settings.set_max_frame_size(val);
-        }
-        else if(id == SETTINGS_MAX_HEADER_LIST_SIZE) settings.set_max_header_list_size(val);
-    }
+    SettingsView view(buff, len, 0);
+
+    if(has_ack_flag() && len != 0) return false;
+    if(view.Valid() == false) return false;
+
+    settings_ = lhttp2::Settings();
+    view.Decode(settings_);
+
+    parameters_ = view.parameters();
 
-    settings_ = settings;
     UpdateLength();
 
     return true;
 }
 
 void SettingsFrame::UpdateLength() {
-    if(has_ack_flag()) {
-        length_ = 0;
-        return;
-    }
+    length_ = has_ack_flag() ? 0 : SettingsLength(settings_);
+}
 
+void SettingsFrame::ApplySettings(const lhttp2::Settings& values, const uint8_t parameters, lhttp2::Settings& settings) {
+    if(parameters & (1 << SETTINGS_HEADER_TABLE_SIZE)) settings.set_header_table_size(values.header_table_size());
+    if(parameters & (1 << SETTINGS_ENABLE_PUSH)) settings.set_enable_push(values.enable_push());
+    if(parameters & (1 << SETTINGS_MAX_CONCURRENT_STREAMS)) settings.set_max_concurrent_stream(values.max_concurrent_stream());
+    if(parameters & (1 << SETTINGS_INITIAL_WINDOW_SIZE)) settings.set_initial_window_size(values.initial_window_size());
+    if(parameters & (1 << SETTINGS_MAX_FRAME_SIZE)) settings.set_max_frame_size(values.max_frame_size());
+    if(parameters & (1 << SETTINGS_MAX_HEADER_LIST_SIZE)) settings.set_max_header_list_size(values.max_header_list_size());
+}
+
+uint8_t SettingsFrame::ChangedParameters(const lhttp2::Settings& settings) {
+    uint8_t parameters = 0;
+
+    if(settings.header_table_size() != 0x1000) parameters |= 1 << SETTINGS_HEADER_TABLE_SIZE;
+    if(settings.enable_push() != true) parameters |= 1 << SETTINGS_ENABLE_PUSH;
+    if(settings.max_concurrent_stream() != UINT32_MAX) parameters |= 1 << SETTINGS_MAX_CONCURRENT_STREAMS;
+    if(settings.initial_window_size() != 0xFFFF) parameters |= 1 << SETTINGS_INITIAL_WINDOW_SIZE;
+    if(settings.max_frame_size() != 0x4000) parameters |= 1 << SETTINGS_MAX_FRAME_SIZE;
+    if(settings.max_header_list_size() != UINT32_MAX) parameters |= 1 << SETTINGS_MAX_HEADER_LIST_SIZE;
+
+    return parameters;
+}
+
+uint32_t SettingsFrame::SettingsLength(const lhttp2::Settings& settings) {
     int setCount = 0;
 
-    if(settings_.header_table_size() != 0x1000) setCount++;
-    if(settings_.enable_push() != true) setCount++;
-    if(settings_.max_concurrent_stream() != UINT32_MAX) setCount++;
-    if(settings_.initial_window_size() != 0xFFFF) setCount++;
-    if(settings_.max_frame_size() != 0x4000) setCount++;
-    if(settings_.max_header_list_size() != UINT32_MAX) setCount++;
+    if(settings.header_table_size() != 0x1000) setCount++;
+    if(settings.enable_push() != true) setCount++;
+    if(settings.max_concurrent_stream() != UINT32_MAX) setCount++;
+    if(settings.initial_window_size() != 0xFFFF) setCount++;
+    if(settings.max_frame_size() != 0x4000) setCount++;
+    if(settings.max_header_list_size() != UINT32_MAX) setCount++;
+
+    return setCount * 6;
+}
+
+void SettingsFrame::EncodeSettings(const lhttp2::Settings& settings, ByteWriter& writer) {
+    if(settings.header_table_size() != 0x1000) {
+        writer.U16(SETTINGS_HEADER_TABLE_SIZE);
+        writer.U32(settings.header_table_size());
+    }
+
+    if(settings.enable_push() != true) {
+        writer.U16(SETTINGS_ENABLE_PUSH);
+        writer.U32(settings.enable_push());
+    }
+
+    if(settings.max_concurrent_stream() != UINT32_MAX) {
+        writer.U16(SETTINGS_MAX_CONCURRENT_STREAMS);
+        writer.U32(settings.max_concurrent_stream());
+    }
+
+    if(settings.initial_window_size() != 0xFFFF) {
+        writer.U16(SETTINGS_INITIAL_WINDOW_SIZE);
+        writer.U32(settings.initial_window_size());
+    }
+
+    if(settings.max_frame_size() != 0x4000) {
+        writer.U16(SETTINGS_MAX_FRAME_SIZE);
+        writer.U32(settings.max_frame_size());
+    }
+
+    if(settings.max_header_list_size() != UINT32_MAX) {
+        writer.U16(SETTINGS_MAX_HEADER_LIST_SIZE);
+        writer.U32(settings.max_header_list_size());
+    }
+}
+
+bool SettingsFrame::DecodeSettings(const char* buff, const uint32_t len, lhttp2::Settings& settings) {
+    SettingsView view(buff, len, 0);
+    if(view.Valid() == false) return false;
 
-    length_ = setCount * 6;
+    view.Decode(settings);
+
+    return true;
 }
 
 /*
@@ -740,11 +959,9 @@ PushPromisFrame::PushPromisFrame() {
     length_ = 4;
 }
 
-PushPromisFrame::PushPromisFrame(uint32_t promised_stream_id, Buffer header_block_fragment, uint8_t pad_length) {
-    PushPromisFrame();
-
+PushPromisFrame::PushPromisFrame(uint32_t promised_stream_id, Buffer header_block_fragment, uint8_t pad_length) : PushPromisFrame() {
     promised_stream_id_ = promised_stream_id;
-    header_block_fragment_ = header_block_fragment;
+    header_block_fragment_ = std::move(header_block_fragment);
 
     pad_length_ = pad_length;
     if(pad_length_ > 0) set_flags(FLAG_PADDED);
@@ -815,36 +1032,34 @@ void PushPromisFrame::clear_padded_flag() {
     UpdateLength();
 }
 
-Buffer* PushPromisFrame::EncodeFramePayload(hpack::Table& hpack_table) {
-    int idx = 0;
-    Buffer *stream = new Buffer(pad_length_ + header_block_fragment_.Length());
+BufferChain PushPromisFrame::EncodeFramePayload(hpack::Table& hpack_table) {
+    uint32_t prefix_len = has_padded_flag() ? 5 : 4;
+    Buffer *payload = BufferPool::Acquire(prefix_len + header_block_fragment_.Length());
+    ByteWriter writer(*payload, prefix_len + header_block_fragment_.Length());
+    BufferChain stream;
 
     if(has_padded_flag()) {
-        stream->Set(pad_length_, 0);
-        idx = 1;
+        writer.U8(pad_length_);
     }
 
-    stream->SetValue((reserved_ << 7) | (promised_stream_id_ & 0x7FFFFFFF), 4, idx);
-    stream->Append(header_block_fragment_);
+    writer.U31(promised_stream_id_, reserved_);
+    writer.Bytes(header_block_fragment_.Address(), header_block_fragment_.Length());
+
+    stream.Append(payload);
+
+    if(has_padded_flag())
+        stream.Append(padding, pad_length_);
 
     return stream;
 }
 
 bool PushPromisFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    int idx = 0;
+    PushPromiseView view(buff, len, flags_);
+    if(view.Valid() == false) return false;
 
-    if(has_padded_flag()) {
-        pad_length_ = buff[idx];
-        idx = idx + 1;
-    }
-
-    reserved_ = ((buff[idx] & 0x80) == 0x80);
-    promised_stream_id_ = (uint32_t)(buff[idx] & 0x7F) << 24 | \
-                        (uint32_t)buff[idx + 1] << 16 | \
-                        (uint32_t)buff[idx + 2] << 8 | \
-                        (uint32_t)buff[idx + 3];
-    
-    header_block_fragment_ = Buffer(buff + idx + 4, len - pad_length_ - idx);
+    pad_length_ = view.pad_length();
+    promised_stream_id_ = view.promised_stream_id();
+    header_block_fragment_ = Buffer(view.header_block_fragment(), view.header_block_fragment_length());
     UpdateLength();
 
     return true;
@@ -865,8 +1080,7 @@ PingFrame::PingFrame() {
     length_ = 8;
 }
 
-PingFrame::PingFrame(uint64_t opaque_data) {
-    PingFrame();
+PingFrame::PingFrame(uint64_t opaque_data) : PingFrame() {
     opaque_data_ = opaque_data;
 }
 
@@ -893,23 +1107,22 @@ void PingFrame::clear_ack_flag() {
     clear_flags(FLAG_ACK);
 }
 
-Buffer* PingFrame::EncodeFramePayload(hpack::Table& hpack_table) {
-    Buffer *stream = new Buffer(8);
+BufferChain PingFrame::EncodeFramePayload(hpack::Table& hpack_table) {
+    Buffer *payload = BufferPool::Acquire(8);
 
-    stream->SetValue(opaque_data_, 8, 0);
+    ByteWriter writer(*payload, 8);
+    writer.U64(opaque_data_);
 
+    BufferChain stream;
+    stream.Append(payload);
     return stream;
 }
 
 bool PingFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    opaque_data_ = (uint64_t)buff[0] << 56 | \
-                  (uint64_t)buff[1] << 48 | \
-                  (uint64_t)buff[2] << 40 | \
-                  (uint64_t)buff[3] << 32 | \
-                  (uint64_t)buff[4] << 24 | \
-                  (uint64_t)buff[5] << 16 | \
-                  (uint64_t)buff[6] << 8 | \
-                  (uint64_t)buff[7];
+    PingView view(buff, len, flags_);
+    if(view.Valid() == false) return false;
+
+    opaque_data_ = view.opaque_data();
 
     UpdateLength();
 
@@ -928,12 +1141,10 @@ GoawayFrame::GoawayFrame() {
     length_ = 8;
 }
 
-GoawayFrame::GoawayFrame(uint32_t last_stream_id, uint32_t error_code, Buffer additional_debug_data) {
-    GoawayFrame();
-
+GoawayFrame::GoawayFrame(uint32_t last_stream_id, uint32_t error_code, Buffer additional_debug_data) : GoawayFrame() {
     last_stream_id_ = last_stream_id;
     error_code_ = error_code;
-    additional_debug_data_ = additional_debug_data;
+    additional_debug_data_ = std::move(additional_debug_data);
 
     UpdateLength();
 }
@@ -974,30 +1185,26 @@ void GoawayFrame::set_additional_debug_data(Buffer& additional_debug_data) {
     UpdateLength();
 }
 
-Buffer* GoawayFrame::EncodeFramePayload(hpack::Table& hpack_table) {
-    Buffer *stream = new Buffer(8 + additional_debug_data_.Length());
+BufferChain GoawayFrame::EncodeFramePayload(hpack::Table& hpack_table) {
+    Buffer *payload = BufferPool::Acquire(8 + additional_debug_data_.Length());
 
-    stream->SetValue((reserved_ << 7) | (last_stream_id_ & 0x7FFFFFFF), 4, 0);
-    stream->SetValue(error_code_, 4, 4);
-    stream->Append(additional_debug_data_);
+    ByteWriter writer(*payload, 8 + additional_debug_data_.Length());
+    writer.U31(last_stream_id_, reserved_);
+    writer.U32(error_code_);
+    writer.Bytes(additional_debug_data_.Address(), additional_debug_data_.Length());
 
+    BufferChain stream;
+    stream.Append(payload);
     return stream;
 }
 
 bool GoawayFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    reserved_ = ((buff[0] & 0x80) == 0x80);
-
-    last_stream_id_ = (uint32_t)(buff[0] & 0x7F) << 24 | \
-                    (uint32_t)buff[1] << 16 | \
-                    (uint32_t)buff[2] << 8 | \
-                    (uint32_t)buff[3];
+    GoawayView view(buff, len, flags_);
+    if(view.Valid() == false) return false;
 
-    error_code_ = (uint32_t)(buff[4] & 0x7F) << 24 | \
-                (uint32_t)buff[5] << 16 | \
-                (uint32_t)buff[6] << 8 | \
-                (uint32_t)buff[7];
-
-    additional_debug_data_ = Buffer(buff + 8, len - 8);
+    last_stream_id_ = view.last_stream_id();
+    error_code_ = view.error_code();
+    additional_debug_data_ = Buffer(view.additional_debug_data(), view.additional_debug_data_length());
 
     UpdateLength();
 
@@ -1016,8 +1223,7 @@ WindowUpdateFrame::WindowUpdateFrame() {
     length_ = 4;
 }
 
-WindowUpdateFrame::WindowUpdateFrame(uint32_t window_size_increment) {
-    WindowUpdateFrame();
+WindowUpdateFrame::WindowUpdateFrame(uint32_t window_size_increment) : WindowUpdateFrame() {
     window_size_increment_ = window_size_increment;
 }
 
@@ -1040,21 +1246,22 @@ void WindowUpdateFrame::set_window_size_increment(int window_size_increment) {
     window_size_increment_ = window_size_increment;
 }
 
-Buffer* WindowUpdateFrame::EncodeFramePayload(hpack::Table& hpack_table) {
-    Buffer *stream = new Buffer(4);
+BufferChain WindowUpdateFrame::EncodeFramePayload(hpack::Table& hpack_table) {
+    Buffer *payload = BufferPool::Acquire(4);
 
-    stream->SetValue((reserved_ << 7) | (window_size_increment_ & 0x7FFFFFFF), 4, 0);
+    ByteWriter writer(*payload, 4);
+    writer.U31(window_size_increment_, reserved_);
 
+    BufferChain stream;
+    stream.Append(payload);
     return stream;
 }
 
 bool WindowUpdateFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
-    reserved_ = ((buff[0] & 0x80) == 0x80);
+    WindowUpdateView view(buff, len, flags_);
+    if(view.Valid() == false) return false;
 
-    window_size_increment_ = (uint32_t)(buff[0] & 0x7F) << 24 | \
-                            (uint32_t)buff[1] << 16 | \
-                            (uint32_t)buff[2] << 8 | \
-                            (uint32_t)buff[3];
+    window_size_increment_ = view.window_size_increment();
 
     UpdateLength();
 
@@ -1072,8 +1279,7 @@ ContinuationFrame::ContinuationFrame() {
     type_ = TYPE_CONTINUATION_FRAME;
 }
 
-ContinuationFrame::ContinuationFrame(Buffer& header_block_fragment) {
-    ContinuationFrame();
+ContinuationFrame::ContinuationFrame(Buffer& header_block_fragment) : ContinuationFrame() {
     header_block_fragment_ = header_block_fragment;
     UpdateLength();
 }
@@ -1085,6 +1291,10 @@ const Buffer& ContinuationFrame::header_block_fragment() const {
     return header_block_fragment_;
 }
 
+const std::vector<hpack::HeaderFieldRepresentation>& ContinuationFrame::header_list() const {
+    return header_list_;
+}
+
 void ContinuationFrame::set_header_block_fragment(Buffer& header_block_fragment) {
     header_block_fragment_ = header_block_fragment;
     UpdateLength();
@@ -1102,15 +1312,25 @@ void ContinuationFrame::clear_end_headers_flag() {
     clear_flags(FLAG_END_HEADERS);
 }
 
-Buffer* ContinuationFrame::EncodeFramePayload(hpack::Table& hpack_table) {
-    Buffer *stream = new Buffer(header_block_fragment_);
+BufferChain ContinuationFrame::EncodeFramePayload(hpack::Table& hpack_table) {
+    Buffer *payload = BufferPool::Acquire(header_block_fragment_.Length());
+    ByteWriter writer(*payload, header_block_fragment_.Length());
+    writer.Bytes(header_block_fragment_.Address(), header_block_fragment_.Length());
+
+    BufferChain stream;
+    stream.Append(payload);
     return stream;
 }
 
 bool ContinuationFrame::DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) {
     header_block_fragment_ = Buffer(buff, len);
     UpdateLength();
-    return true;
+
+    // Only blocks started by a HEADERS frame are decoded.
+    if(hpack_table.Decoding() == false) return true;
+
+    hpack::Table::DECODE_STATUS status = hpack_table.DecodeFragment(header_list_, buff, len, has_end_headers_flag());
+    return status == hpack::Table::DECODE_COMPLETE || status == hpack::Table::DECODE_INCOMPLETE;
 }
 
 void ContinuationFrame::UpdateLength() {
@@ -4,11 +4,17 @@
 #include <string>
 #include <cstdint>
 
-#include "buffer/Buffer.h"
+#include "buffer/buffer.h"
+#include "buffer/buffer_chain.h"
+#include "buffer/buffer_slice.h"
+#include "buffer/byte_cursor.h"
+#include "memory/memory_resource.h"
 #include "hpack/hpack.h"
 #include "settings.h"
 #include "error.h"
 
+#define FRAME_HEADER_LENGTH 9
+
 namespace lhttp2 {
     class Frame;                  // Header of frame
 
@@ -68,6 +74,13 @@ namespace lhttp2 {
 
         virtual ~Frame() = 0;
 
+        // Frames remember the resource they were allocated from, so a plain delete
+        // always returns the memory to the right place.
+        static void* operator new(size_t size);
+        static void* operator new(size_t size, MemoryResource* resource);
+        static void operator delete(void* p);
+        static void operator delete(void* p, MemoryResource* resource);
+
         const uint32_t length() const;
         const FRAME_TYPE type() const;
         const uint8_t flags() const;
@@ -81,13 +94,28 @@ namespace lhttp2 {
         void set_stream_id(uint32_t streamId);
 
         static Frame* RecvFrame(const int fd, hpack::Table& hpack_table, bool debug = false);
+        static Frame* RecvFrame(const int fd, hpack::Table& hpack_table, MemoryResource* resource, bool debug = false);
         static int SendFrame(const int fd, Frame* frame, hpack::Table& hpack_table, bool debug = false);
+
+        // Frame of a FRAME_HEADER_LENGTH octet header and its payload, nullptr if
+        // the type is unknown or the payload is malformed.
+        static Frame* Decode(const char* header, const BufferSlice& payload, hpack::Table& hpack_table, MemoryResource* resource = nullptr);
         static const std::string GetFrameTypeName(FRAME_TYPE type);
 
+        // Frame header and payload as they go on the wire. The chain owns or references
+        // every byte, so it may be written after the frame has been deleted.
+        // A header block which does not fit into max_frame_size, the peer's
+        // SETTINGS_MAX_FRAME_SIZE, is split into CONTINUATION frames following
+        // the HEADERS or PUSH_PROMISE frame in the same chain. An empty chain if
+        // the payload could not be encoded, nothing must be sent then.
+        BufferChain EncodeFrame(hpack::Table& hpack_table, const uint32_t max_frame_size = 0x4000);
+
     protected:
-        Buffer* EncodeFrame(hpack::Table& hpack_table);
-        virtual Buffer* EncodeFramePayload(hpack::Table& hpack_table) = 0;
+        BufferChain EncodeHeaderBlockFrames(const BufferChain& payload, const uint32_t max_frame_size);
+
+        virtual BufferChain EncodeFramePayload(hpack::Table& hpack_table) = 0;
         virtual bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) = 0;
+        virtual bool DecodeFramePayload(const BufferSlice& payload, hpack::Table& hpack_table);
         virtual void UpdateLength() = 0;
 
         uint32_t length_ = 0;
@@ -95,6 +123,7 @@ namespace lhttp2 {
         uint8_t flags_ = 0;
         uint32_t stream_id_ = 0;
         bool reserved_ = false;
+        bool encode_failed_ = false;    // set by EncodeFramePayload(), checked by EncodeFrame()
     };
 
     /*
@@ -119,13 +148,15 @@ namespace lhttp2 {
     public:
         DataFrame();
         DataFrame(Buffer data, uint8_t pad_length = 0);
+        DataFrame(BufferSlice data, uint8_t pad_length = 0);
         ~DataFrame();
 
         const uint8_t pad_length() const;
-        const Buffer& data() const;
+        const BufferSlice& data() const;
 
         void set_pad_length(uint8_t pad_length);
         void set_data(Buffer& data);
+        void set_data(const BufferSlice& data);
 
         bool has_end_stream_flag() const;
         bool has_padded_flag() const;
@@ -137,12 +168,13 @@ namespace lhttp2 {
         void clear_padded_flag();
 
     private:
-        Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
+        BufferChain EncodeFramePayload(hpack::Table& hpack_table) override;
         bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
+        bool DecodeFramePayload(const BufferSlice& payload, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
         uint8_t pad_length_ = 0;
-        Buffer data_;
+        BufferSlice data_;
     };
 
     /*
@@ -177,16 +209,24 @@ namespace lhttp2 {
         const uint32_t stream_dependency() const;
         const uint8_t weight() const;
         const std::vector<hpack::HeaderFieldRepresentation>& header_list() const;
+
+        // Received header block, empty for a frame built from a header list.
         const Buffer& header_block_fragment() const;
 
         void set_pad_length(uint8_t pad_length);
         void set_exclusive(bool exclusive);
         void set_stream_dependency(uint32_t stream_dependency);
         void set_weight(uint8_t weight);
-        void set_header_list(std::vector<hpack::HeaderFieldRepresentation> header_list, hpack::Table& hpack_table);
 
+        // The header list is HPACK encoded only once, by EncodeFrame() with the table
+        // of the connection. Until then length() is an upper bound. hpack_table is
+        // not used any more.
+        void set_header_list(std::vector<hpack::HeaderFieldRepresentation> header_list, hpack::Table& hpack_table);
         void update_header_block_fragment(hpack::Table& hpack_table);
 
+        // Adds a received CONTINUATION frame, its fields and its fragment, to this frame.
+        void append_continuation(const ContinuationFrame& continuation);
+
         bool has_end_stream_flag() const;
         bool has_end_headers_flag() const;
         bool has_padded_flag() const;
@@ -203,7 +243,7 @@ namespace lhttp2 {
         void clear_priority_flag();
 
     private:
-        Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
+        BufferChain EncodeFramePayload(hpack::Table& hpack_table) override;
         bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
@@ -243,7 +283,7 @@ namespace lhttp2 {
         void set_weight(uint8_t weight);
 
     private:
-        Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
+        BufferChain EncodeFramePayload(hpack::Table& hpack_table) override;
         bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
@@ -274,7 +314,7 @@ namespace lhttp2 {
         void set_error_code(uint32_t error_code);
 
     private:
-        Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
+        BufferChain EncodeFramePayload(hpack::Table& hpack_table) override;
         bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
@@ -318,12 +358,29 @@ namespace lhttp2 {
         void set_ack_flag();
         void clear_ack_flag();
 
+        // Whether the frame carries the parameter. settings() holds the defaults for the others.
+        bool has_parameter(SETTINGS_PARAMETERS id) const;
+
+        // Sets the parameters the frame carries in settings, the others keep their values (RFC 7540 6.5.3).
+        void Apply(lhttp2::Settings& settings) const;
+
+        // Wire form of settings, only the values which differ from the defaults are sent.
+        // Decoding sets the parameters found on top of settings.
+        static uint32_t SettingsLength(const lhttp2::Settings& settings);
+        static uint8_t ChangedParameters(const lhttp2::Settings& settings);
+
+        // Sets the parameters of values in settings whose bit 1 << id is set in parameters.
+        static void ApplySettings(const lhttp2::Settings& values, const uint8_t parameters, lhttp2::Settings& settings);
+        static void EncodeSettings(const lhttp2::Settings& settings, ByteWriter& writer);
+        static bool DecodeSettings(const char* buff, const uint32_t len, lhttp2::Settings& settings);
+
     private:
-        Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
+        BufferChain EncodeFramePayload(hpack::Table& hpack_table) override;
         bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
         lhttp2::Settings settings_;
+        uint8_t parameters_ = 0;    // bit 1 << id for every parameter carried
     };
 
     /*
@@ -371,7 +428,7 @@ namespace lhttp2 {
         void clear_padded_flag();
 
     private:
-        Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
+        BufferChain EncodeFramePayload(hpack::Table& hpack_table) override;
         bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
@@ -409,7 +466,7 @@ namespace lhttp2 {
         void clear_ack_flag();
 
     private:
-        Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
+        BufferChain EncodeFramePayload(hpack::Table& hpack_table) override;
         bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
@@ -450,7 +507,7 @@ namespace lhttp2 {
         void set_additional_debug_data(Buffer& additional_debug_data);
 
     private:
-        Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
+        BufferChain EncodeFramePayload(hpack::Table& hpack_table) override;
         bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
@@ -482,7 +539,7 @@ namespace lhttp2 {
         void set_window_size_increment(int window_size_increment);
 
     private:
-        Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
+        BufferChain EncodeFramePayload(hpack::Table& hpack_table) override;
         bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
@@ -498,6 +555,9 @@ namespace lhttp2 {
         as long as the preceding frame is on the same stream and is a HEADERS, 
         PUSH_PROMISE, or CONTINUATION frame without the END_HEADERS flag set.
 
+        When the frame continues a header block of a HEADERS frame, header_list
+        holds the fields completed by this fragment.
+
         +---------------------------------------------------------------+
         |                   Header Block Fragment (*)                 ...
         +---------------------------------------------------------------+
@@ -509,6 +569,7 @@ namespace lhttp2 {
         ~ContinuationFrame();
 
         const Buffer& header_block_fragment() const;
+        const std::vector<hpack::HeaderFieldRepresentation>& header_list() const;
         void set_header_block_fragment(Buffer& header_block_fragment);
 
         bool has_end_headers_flag();
@@ -516,11 +577,12 @@ namespace lhttp2 {
         void clear_end_headers_flag();
 
     private:
-        Buffer* EncodeFramePayload(hpack::Table& hpack_table) override;
+        BufferChain EncodeFramePayload(hpack::Table& hpack_table) override;
         bool DecodeFramePayload(const char* buff, const int len, hpack::Table& hpack_table) override;
         void UpdateLength() override;
 
         Buffer header_block_fragment_;
+        std::vector<hpack::HeaderFieldRepresentation> header_list_;
     };
 };
 
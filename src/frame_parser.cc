@@ -0,0 +1,257 @@
+#include <cstring>
+
+#include "frame_parser.h"
+
+using namespace lhttp2;
+
+FrameParser::FrameParser(hpack::Table& hpack_table, MemoryResource* resource) : hpack_table_(hpack_table), resource_(resource != nullptr ? resource : NewDeleteResource()) {
+}
+
+FrameParser::~FrameParser() {
+    if(block_ != nullptr) block_->Unref();
+}
+
+bool FrameParser::Feed(const char* buff, const uint32_t len, std::vector<Frame*>& frames) {
+    uint32_t offset = 0, n;
+
+    if(error_ != HTTP2_ERROR_NO_ERROR) return false;
+
+    while(offset < len) {
+        if(header_len_ < FRAME_HEADER_LENGTH) {
+            n = FRAME_HEADER_LENGTH - header_len_;
+            if(n > len - offset) n = len - offset;
+
+            memcpy(header_ + header_len_, buff + offset, n);
+            header_len_ = header_len_ + n;
+            offset = offset + n;
+
+            if(header_len_ < FRAME_HEADER_LENGTH) break;
+            if(StartPayload() == false) return false;
+        }
+
+        n = length_ - received_;
+        if(n > len - offset) n = len - offset;
+
+        if(block_ != nullptr) memcpy(block_->Address() + received_, buff + offset, n);
+        received_ = received_ + n;
+        offset = offset + n;
+
+        if(received_ == length_ && FinishFrame(frames) == false) return false;
+    }
+
+    return true;
+}
+
+HTTP2_ERROR_CODE FrameParser::Error() const {
+    return error_;
+}
+
+void FrameParser::SetMaxFrameSize(uint32_t max_frame_size) {
+    max_frame_size_ = max_frame_size;
+}
+
+void FrameParser::SetMemoryResource(MemoryResource* resource) {
+    resource_ = (resource != nullptr) ? resource : NewDeleteResource();
+}
+
+void FrameParser::Reset() {
+    if(block_ != nullptr) block_->Unref();
+    block_ = nullptr;
+
+    header_len_ = 0;
+    length_ = 0;
+    received_ = 0;
+    pending_ = 0;
+    error_ = HTTP2_ERROR_NO_ERROR;
+}
+
+bool FrameParser::StartPayload() {
+    ByteReader header(header_, FRAME_HEADER_LENGTH);
+    length_ = header.U24();
+    uint8_t type = header.U8();
+    received_ = 0;
+
+    if(length_ > max_frame_size_) {
+        error_ = HTTP2_ERROR_FRAME_SIZE_ERROR;
+        return false;
+    }
+
+    // Payloads of unknown frame types are only counted, never stored.
+    if(type > Frame::TYPE_CONTINUATION_FRAME) return true;
+
+    // Payloads may outlive the resource and be released on any thread, they come from malloc.
+    block_ = BufferBlock::Create(length_);
+    if(block_ == nullptr) {
+        error_ = HTTP2_ERROR_INTERNAL_ERROR;
+        return false;
+    }
+
+    return true;
+}
+
+bool FrameParser::FinishFrame(std::vector<Frame*>& frames) {
+    header_len_ = 0;
+    if(block_ == nullptr) return true;
+
+    // The payload slice keeps the block alive for frames which hold on to it (DATA).
+    BufferSlice payload(block_, 0, length_);
+    block_->Unref();
+    block_ = nullptr;
+
+    Frame* frame = Frame::Decode(header_, payload, hpack_table_, resource_);
+    if(frame == nullptr) {
+        SetDecodeError(header_, payload.Address());
+        return false;
+    }
+
+    frames.push_back(frame);
+    return true;
+}
+
+bool FrameParser::Parse(const BufferSlice& data, uint32_t& consumed, std::vector<Frame*>& frames) {
+    const char* buff = data.Address();
+    uint32_t len = data.Length(), length;
+    uint8_t type;
+
+    consumed = 0;
+    pending_ = 0;
+    if(error_ != HTTP2_ERROR_NO_ERROR) return false;
+
+    while(len - consumed >= FRAME_HEADER_LENGTH) {
+        ByteReader header(buff + consumed, FRAME_HEADER_LENGTH);
+        length = header.U24();
+        type = header.U8();
+
+        if(length > max_frame_size_) {
+            error_ = HTTP2_ERROR_FRAME_SIZE_ERROR;
+            return false;
+        }
+
+        if(length > len - consumed - FRAME_HEADER_LENGTH) {
+            pending_ = FRAME_HEADER_LENGTH + length;
+            return true;
+        }
+
+        // Frames of unknown types are skipped.
+        if(type <= Frame::TYPE_CONTINUATION_FRAME) {
+            Frame* frame = Frame::Decode(buff + consumed, data.Slice(consumed + FRAME_HEADER_LENGTH, length), hpack_table_, resource_);
+            if(frame == nullptr) {
+                SetDecodeError(buff + consumed, buff + consumed + FRAME_HEADER_LENGTH);
+                return false;
+            }
+            frames.push_back(frame);
+        }
+
+        consumed = consumed + FRAME_HEADER_LENGTH + length;
+    }
+
+    if(consumed < len) pending_ = FRAME_HEADER_LENGTH;
+    return true;
+}
+
+bool FrameParser::Parse(const BufferSlice& data, uint32_t& consumed, FrameValue* frames, const uint32_t max, uint32_t& count) {
+    const char* buff = data.Address();
+    uint32_t len = data.Length(), length;
+    uint8_t type;
+
+    consumed = 0;
+    count = 0;
+    pending_ = 0;
+    if(error_ != HTTP2_ERROR_NO_ERROR) return false;
+
+    while(len - consumed >= FRAME_HEADER_LENGTH) {
+        ByteReader header(buff + consumed, FRAME_HEADER_LENGTH);
+        length = header.U24();
+        type = header.U8();
+
+        if(length > max_frame_size_) {
+            error_ = HTTP2_ERROR_FRAME_SIZE_ERROR;
+            return false;
+        }
+
+        if(length > len - consumed - FRAME_HEADER_LENGTH) {
+            pending_ = FRAME_HEADER_LENGTH + length;
+            return true;
+        }
+
+        if(type <= Frame::TYPE_CONTINUATION_FRAME) {
+            if(count == max) return true;
+
+            if(frames[count].Decode(buff + consumed, data.Slice(consumed + FRAME_HEADER_LENGTH, length)) == false) {
+                SetDecodeError(buff + consumed, buff + consumed + FRAME_HEADER_LENGTH);
+                return false;
+            }
+            count++;
+        }
+
+        consumed = consumed + FRAME_HEADER_LENGTH + length;
+    }
+
+    if(consumed < len) pending_ = FRAME_HEADER_LENGTH;
+    return true;
+}
+
+bool FrameParser::Parse(const char* buff, const uint32_t len, uint32_t& consumed, FrameView* frames, const uint32_t max, uint32_t& count) {
+    consumed = 0;
+    count = 0;
+    pending_ = 0;
+    if(error_ != HTTP2_ERROR_NO_ERROR) return false;
+
+    while(len - consumed >= FRAME_HEADER_LENGTH && count < max) {
+        FrameView frame(buff + consumed, len - consumed);
+
+        if(frame.length() > max_frame_size_) {
+            error_ = HTTP2_ERROR_FRAME_SIZE_ERROR;
+            return false;
+        }
+
+        if(frame.Complete() == false) {
+            pending_ = frame.size();
+            return true;
+        }
+
+        frames[count++] = frame;
+        consumed = consumed + frame.size();
+    }
+
+    if(consumed < len && count < max) pending_ = FRAME_HEADER_LENGTH;
+    return true;
+}
+
+uint32_t FrameParser::Pending() const {
+    return pending_;
+}
+
+/*
+    Connection error for a frame which failed to decode. A payload whose length
+    does not fit the frame type is a FRAME_SIZE_ERROR (RFC 7540 4.2), a header
+    block the hpack table rejected a COMPRESSION_ERROR, anything else (bad
+    padding, ...) a PROTOCOL_ERROR.
+*/
+void FrameParser::SetDecodeError(const char* header, const char* payload) {
+    FrameView frame(header, FRAME_HEADER_LENGTH);
+    uint32_t len = frame.length();
+    uint8_t flags = frame.flags();
+    bool size_valid = true;
+
+    switch(frame.type()) {
+        case Frame::TYPE_PRIORITY_FRAME : size_valid = PriorityView(payload, len, flags).Valid(); break;
+        case Frame::TYPE_RST_STREAM_FRAME : size_valid = RSTStreamView(payload, len, flags).Valid(); break;
+        case Frame::TYPE_SETTINGS_FRAME : size_valid = SettingsView(payload, len, flags).Valid(); break;
+        case Frame::TYPE_PING_FRAME : size_valid = PingView(payload, len, flags).Valid(); break;
+        case Frame::TYPE_GOAWAY_FRAME : size_valid = GoawayView(payload, len, flags).Valid(); break;
+        case Frame::TYPE_WINDOW_UPDATE_FRAME : size_valid = WindowUpdateView(payload, len, flags).Valid(); break;
+        case Frame::TYPE_HEADERS_FRAME :
+        case Frame::TYPE_PUSH_PROMISE_FRAME :
+        case Frame::TYPE_CONTINUATION_FRAME :
+            switch(hpack_table_.DecodeStatus()) {
+                case hpack::Table::DECODE_COMPRESSION_ERROR : error_ = HTTP2_ERROR_COMPRESSION_ERROR; return;
+                case hpack::Table::DECODE_HEADER_LIST_TOO_LARGE : error_ = HTTP2_ERROR_ENHANCE_YOUR_CALM; return;
+                default : break;
+            }
+            break;
+        default : break;
+    }
+
+    error_ = size_valid ? HTTP2_ERROR_PROTOCOL_ERROR : HTTP2_ERROR_FRAME_SIZE_ERROR;
+}
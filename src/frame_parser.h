@@ -0,0 +1,100 @@
+#ifndef _LHTTP2_FRAME_PARSER_H_
+#define _LHTTP2_FRAME_PARSER_H_
+
+#include <vector>
+#include <stdint.h>
+
+#include "frame.h"
+#include "frame_value.h"
+#include "frame_view.h"
+#include "error.h"
+#include "buffer/buffer_slice.h"
+#include "memory/memory_resource.h"
+
+namespace lhttp2 {
+    /*
+        ### Frame parser ###
+
+        Push parser turning a byte stream into frames. Feed() takes the bytes in
+        whatever chunks the transport delivers them, one octet or many frames at
+        a time, keeps a partial frame across calls and appends every frame which
+        got complete to the given list. It never touches a socket, so it works
+        with blocking or non-blocking sockets, TLS or any other I/O backend.
+
+        Frames are decoded in order of arrival, header blocks with the given hpack
+        table. Frames of unknown types are skipped (RFC 7540 4.1). A frame larger
+        than the maximum frame size or one which fails to decode is a connection
+        error, Feed() returns false from then on and Error() tells the code to
+        send in the GOAWAY.
+    */
+    class FrameParser {
+    public:
+        FrameParser(hpack::Table& hpack_table, MemoryResource* resource = nullptr);
+        ~FrameParser();
+
+        FrameParser(const FrameParser& a) = delete;
+        void operator=(const FrameParser& a) = delete;
+
+        bool Feed(const char* buff, const uint32_t len, std::vector<Frame*>& frames);
+
+        /*
+            Zero-copy variant for callers which own the receive buffer. Every frame
+            lying completely within data is decoded in place, its payload being a
+            slice of the block of data. consumed is set to the octets of those
+            frames; the partial frame behind them is left to the caller, to be
+            presented again together with the bytes which follow. Pending() then
+            tells how many octets that frame takes as far as known. Parse() and
+            Feed() must not be mixed while Feed() holds a partial frame.
+        */
+        bool Parse(const BufferSlice& data, uint32_t& consumed, std::vector<Frame*>& frames);
+        uint32_t Pending() const;
+
+        /*
+            Same as above, decoding into up to max values of caller-owned storage
+            without any allocation. count is set to the values filled; once
+            storage runs out the frames left are not consumed. Header blocks
+            stay encoded, the caller passes them to FrameValue::DecodeHeaderBlock()
+            in order.
+        */
+        bool Parse(const BufferSlice& data, uint32_t& consumed, FrameValue* frames, const uint32_t max, uint32_t& count);
+
+        /*
+            Routing variant, frames are only delimited and checked against the
+            maximum frame size. The views point into buff and nothing is decoded,
+            frames of unknown types included, so the hpack table is left alone:
+            header blocks routed this way must be decoded by whoever receives them.
+        */
+        bool Parse(const char* buff, const uint32_t len, uint32_t& consumed, FrameView* frames, const uint32_t max, uint32_t& count);
+
+        HTTP2_ERROR_CODE Error() const;
+
+        // Our SETTINGS_MAX_FRAME_SIZE, 16384 until changed.
+        void SetMaxFrameSize(uint32_t max_frame_size);
+
+        // Frames are allocated from resource, their payloads always from malloc.
+        void SetMemoryResource(MemoryResource* resource);
+
+        // Drops the partial frame and the error.
+        void Reset();
+
+    private:
+        bool StartPayload();
+        bool FinishFrame(std::vector<Frame*>& frames);
+        void SetDecodeError(const char* header, const char* payload);
+
+        hpack::Table& hpack_table_;
+        MemoryResource* resource_;
+        uint32_t max_frame_size_ = 0x4000;
+
+        char header_[FRAME_HEADER_LENGTH];
+        uint32_t header_len_ = 0;
+        uint32_t length_ = 0;               // payload length of the current frame
+        uint32_t received_ = 0;             // payload octets received so far
+        BufferBlock* block_ = nullptr;      // payload of the current frame, nullptr when skipped
+        uint32_t pending_ = 0;              // size of the partial frame left by Parse()
+
+        HTTP2_ERROR_CODE error_ = HTTP2_ERROR_NO_ERROR;
+    };
+};
+
+#endif
@@ -0,0 +1,399 @@
+#include "frame_value.h"
+#include "frame_view.h"
+#include "buffer/buffer_pool.h"
+#include "buffer/byte_cursor.h"
+
+using namespace lhttp2;
+
+// Padding octets are always zero, so every padded frame borrows them from here.
+static const char padding[256] = {0};
+
+FrameValue::FrameValue() {
+}
+
+FrameValue::FrameValue(Frame::FRAME_TYPE type, uint32_t stream_id) {
+    type_ = type;
+    stream_id_ = stream_id;
+}
+
+FrameValue FrameValue::MakeData(uint32_t stream_id, const BufferSlice& data, uint8_t pad_length) {
+    FrameValue value(Frame::TYPE_DATA_FRAME, stream_id);
+    value.bytes_ = data;
+    value.payload_.headers = {pad_length, false, 0, 16};
+    if(pad_length > 0) value.flags_ = Frame::FLAG_PADDED;
+
+    value.UpdateLength();
+    return value;
+}
+
+FrameValue FrameValue::MakeHeaders(uint32_t stream_id, const BufferSlice& header_block_fragment, uint8_t pad_length) {
+    FrameValue value(Frame::TYPE_HEADERS_FRAME, stream_id);
+    value.bytes_ = header_block_fragment;
+    value.payload_.headers = {pad_length, false, 0, 16};
+    value.flags_ = Frame::FLAG_END_HEADERS;
+    if(pad_length > 0) value.flags_ |= Frame::FLAG_PADDED;
+
+    value.UpdateLength();
+    return value;
+}
+
+FrameValue FrameValue::MakePriority(uint32_t stream_id, bool exclusive, uint32_t stream_dependency, uint8_t weight) {
+    FrameValue value(Frame::TYPE_PRIORITY_FRAME, stream_id);
+    value.payload_.headers = {0, exclusive, stream_dependency, weight};
+
+    value.UpdateLength();
+    return value;
+}
+
+FrameValue FrameValue::MakeRSTStream(uint32_t stream_id, uint32_t error_code) {
+    FrameValue value(Frame::TYPE_RST_STREAM_FRAME, stream_id);
+    value.payload_.rst_stream = {error_code};
+
+    value.UpdateLength();
+    return value;
+}
+
+FrameValue FrameValue::MakeSettings(const lhttp2::Settings& settings) {
+    FrameValue value(Frame::TYPE_SETTINGS_FRAME, 0);
+    value.payload_.settings = {settings, SettingsFrame::ChangedParameters(settings)};
+
+    value.UpdateLength();
+    return value;
+}
+
+FrameValue FrameValue::MakeSettingsAck() {
+    FrameValue value(Frame::TYPE_SETTINGS_FRAME, 0);
+    value.payload_.settings = {lhttp2::Settings(), 0};
+    value.flags_ = Frame::FLAG_ACK;
+
+    value.UpdateLength();
+    return value;
+}
+
+FrameValue FrameValue::MakePushPromise(uint32_t stream_id, uint32_t promised_stream_id, const BufferSlice& header_block_fragment, uint8_t pad_length) {
+    FrameValue value(Frame::TYPE_PUSH_PROMISE_FRAME, stream_id);
+    value.bytes_ = header_block_fragment;
+    value.payload_.push_promise = {pad_length, promised_stream_id};
+    value.flags_ = Frame::FLAG_END_HEADERS;
+    if(pad_length > 0) value.flags_ |= Frame::FLAG_PADDED;
+
+    value.UpdateLength();
+    return value;
+}
+
+FrameValue FrameValue::MakePing(uint64_t opaque_data, bool ack) {
+    FrameValue value(Frame::TYPE_PING_FRAME, 0);
+    value.payload_.ping = {opaque_data};
+    if(ack) value.flags_ = Frame::FLAG_ACK;
+
+    value.UpdateLength();
+    return value;
+}
+
+FrameValue FrameValue::MakeGoaway(uint32_t last_stream_id, uint32_t error_code, const BufferSlice& additional_debug_data) {
+    FrameValue value(Frame::TYPE_GOAWAY_FRAME, 0);
+    value.bytes_ = additional_debug_data;
+    value.payload_.goaway = {last_stream_id, error_code};
+
+    value.UpdateLength();
+    return value;
+}
+
+FrameValue FrameValue::MakeWindowUpdate(uint32_t stream_id, uint32_t window_size_increment) {
+    FrameValue value(Frame::TYPE_WINDOW_UPDATE_FRAME, stream_id);
+    value.payload_.window_update = {window_size_increment};
+
+    value.UpdateLength();
+    return value;
+}
+
+FrameValue FrameValue::MakeContinuation(uint32_t stream_id, const BufferSlice& header_block_fragment) {
+    FrameValue value(Frame::TYPE_CONTINUATION_FRAME, stream_id);
+    value.bytes_ = header_block_fragment;
+    value.flags_ = Frame::FLAG_END_HEADERS;
+
+    value.UpdateLength();
+    return value;
+}
+
+const uint32_t FrameValue::length() const {
+    return length_;
+}
+
+const Frame::FRAME_TYPE FrameValue::type() const {
+    return type_;
+}
+
+const uint8_t FrameValue::flags() const {
+    return flags_;
+}
+
+const uint32_t FrameValue::stream_id() const {
+    return stream_id_;
+}
+
+const bool FrameValue::reserved() const {
+    return reserved_;
+}
+
+void FrameValue::set_flags(uint8_t flags) {
+    flags_ |= flags;
+    UpdateLength();
+}
+
+void FrameValue::clear_flags(uint8_t flags) {
+    flags_ &= ~flags;
+    UpdateLength();
+}
+
+bool FrameValue::has_flags(uint8_t flags) const {
+    return (flags_ & flags) == flags;
+}
+
+const uint8_t FrameValue::pad_length() const {
+    if(has_flags(Frame::FLAG_PADDED) == false) return 0;
+
+    switch(type_) {
+        case Frame::TYPE_DATA_FRAME :
+        case Frame::TYPE_HEADERS_FRAME : return payload_.headers.pad_length;
+        case Frame::TYPE_PUSH_PROMISE_FRAME : return payload_.push_promise.pad_length;
+        default : return 0;
+    }
+}
+
+const bool FrameValue::exclusive() const {
+    return payload_.headers.exclusive;
+}
+
+const uint32_t FrameValue::stream_dependency() const {
+    return payload_.headers.stream_dependency;
+}
+
+const uint8_t FrameValue::weight() const {
+    return payload_.headers.weight;
+}
+
+void FrameValue::set_priority(bool exclusive, uint32_t stream_dependency, uint8_t weight) {
+    payload_.headers.exclusive = exclusive;
+    payload_.headers.stream_dependency = stream_dependency;
+    payload_.headers.weight = weight;
+
+    if(type_ == Frame::TYPE_HEADERS_FRAME) set_flags(Frame::FLAG_PRIORITY);
+}
+
+const uint32_t FrameValue::error_code() const {
+    return (type_ == Frame::TYPE_GOAWAY_FRAME) ? payload_.goaway.error_code : payload_.rst_stream.error_code;
+}
+
+const lhttp2::Settings& FrameValue::settings() const {
+    return payload_.settings.values;
+}
+
+bool FrameValue::has_parameter(SettingsFrame::SETTINGS_PARAMETERS id) const {
+    return (payload_.settings.parameters & (1 << id)) != 0;
+}
+
+void FrameValue::Apply(lhttp2::Settings& settings) const {
+    SettingsFrame::ApplySettings(payload_.settings.values, payload_.settings.parameters, settings);
+}
+
+const uint32_t FrameValue::promised_stream_id() const {
+    return payload_.push_promise.promised_stream_id;
+}
+
+const uint64_t FrameValue::opaque_data() const {
+    return payload_.ping.opaque_data;
+}
+
+const uint32_t FrameValue::last_stream_id() const {
+    return payload_.goaway.last_stream_id;
+}
+
+const uint32_t FrameValue::window_size_increment() const {
+    return payload_.window_update.window_size_increment;
+}
+
+const BufferSlice& FrameValue::data() const {
+    return bytes_;
+}
+
+const BufferSlice& FrameValue::header_block_fragment() const {
+    return bytes_;
+}
+
+const BufferSlice& FrameValue::additional_debug_data() const {
+    return bytes_;
+}
+
+bool FrameValue::Decode(const char* header_buff, const BufferSlice& payload) {
+    FrameView header(header_buff, FRAME_HEADER_LENGTH);
+    const char* buff = payload.Address();
+
+    length_ = header.length();
+    type_ = header.type();
+    flags_ = header.flags();
+    stream_id_ = header.stream_id();
+    reserved_ = header.reserved();
+
+    if(length_ != payload.Length()) return false;
+
+    bytes_.Clear();
+
+    switch(type_) {
+        case Frame::TYPE_DATA_FRAME : {
+            DataView view(buff, length_, flags_);
+            if(view.Valid() == false) return false;
+
+            payload_.headers = {view.pad_length(), false, 0, 16};
+            bytes_ = payload.Slice(view.data() - buff, view.data_length());
+            return true;
+        }
+        case Frame::TYPE_HEADERS_FRAME : {
+            HeadersView view(buff, length_, flags_);
+            if(view.Valid() == false) return false;
+
+            payload_.headers = {view.pad_length(), view.exclusive(), view.stream_dependency(), view.weight()};
+            bytes_ = payload.Slice(view.header_block_fragment() - buff, view.header_block_fragment_length());
+            return true;
+        }
+        case Frame::TYPE_PRIORITY_FRAME : {
+            PriorityView view(buff, length_, flags_);
+            if(view.Valid() == false) return false;
+
+            payload_.headers = {0, view.exclusive(), view.stream_dependency(), view.weight()};
+            return true;
+        }
+        case Frame::TYPE_RST_STREAM_FRAME : {
+            RSTStreamView view(buff, length_, flags_);
+            if(view.Valid() == false) return false;
+
+            payload_.rst_stream = {view.error_code()};
+            return true;
+        }
+        case Frame::TYPE_SETTINGS_FRAME : {
+            SettingsView view(buff, length_, flags_);
+            if(view.Valid() == false) return false;
+
+            payload_.settings = {lhttp2::Settings(), view.parameters()};
+            view.Decode(payload_.settings.values);
+            return true;
+        }
+        case Frame::TYPE_PUSH_PROMISE_FRAME : {
+            PushPromiseView view(buff, length_, flags_);
+            if(view.Valid() == false) return false;
+
+            payload_.push_promise = {view.pad_length(), view.promised_stream_id()};
+            bytes_ = payload.Slice(view.header_block_fragment() - buff, view.header_block_fragment_length());
+            return true;
+        }
+        case Frame::TYPE_PING_FRAME : {
+            PingView view(buff, length_, flags_);
+            if(view.Valid() == false) return false;
+
+            payload_.ping = {view.opaque_data()};
+            return true;
+        }
+        case Frame::TYPE_GOAWAY_FRAME : {
+            GoawayView view(buff, length_, flags_);
+            if(view.Valid() == false) return false;
+
+            payload_.goaway = {view.last_stream_id(), view.error_code()};
+            bytes_ = payload.Slice(view.additional_debug_data() - buff, view.additional_debug_data_length());
+            return true;
+        }
+        case Frame::TYPE_WINDOW_UPDATE_FRAME : {
+            WindowUpdateView view(buff, length_, flags_);
+            if(view.Valid() == false) return false;
+
+            payload_.window_update = {view.window_size_increment()};
+            return true;
+        }
+        case Frame::TYPE_CONTINUATION_FRAME :
+            bytes_ = payload;
+            return true;
+        default :
+            return false;
+    }
+}
+
+BufferChain FrameValue::Encode() const {
+    uint32_t prefix_len = PrefixLength();
+    Buffer* prefix = BufferPool::Acquire(FRAME_HEADER_LENGTH + prefix_len);
+
+    // The header and the fixed part of the payload share one buffer.
+    ByteWriter writer(*prefix, FRAME_HEADER_LENGTH + prefix_len);
+    writer.U24(length_);
+    writer.U8(type_);
+    writer.U8(flags_);
+    writer.U31(stream_id_, reserved_);
+
+    switch(type_) {
+        case Frame::TYPE_DATA_FRAME :
+        case Frame::TYPE_HEADERS_FRAME :
+            if(has_flags(Frame::FLAG_PADDED)) writer.U8(payload_.headers.pad_length);
+            if(type_ == Frame::TYPE_HEADERS_FRAME && has_flags(Frame::FLAG_PRIORITY)) {
+                writer.U31(payload_.headers.stream_dependency, payload_.headers.exclusive);
+                writer.U8(payload_.headers.weight);
+            }
+            break;
+        case Frame::TYPE_PRIORITY_FRAME :
+            writer.U31(payload_.headers.stream_dependency, payload_.headers.exclusive);
+            writer.U8(payload_.headers.weight);
+            break;
+        case Frame::TYPE_RST_STREAM_FRAME : writer.U32(payload_.rst_stream.error_code); break;
+        case Frame::TYPE_SETTINGS_FRAME :
+            if(has_flags(Frame::FLAG_ACK) == false) SettingsFrame::EncodeSettings(payload_.settings.values, writer);
+            break;
+        case Frame::TYPE_PUSH_PROMISE_FRAME :
+            if(has_flags(Frame::FLAG_PADDED)) writer.U8(payload_.push_promise.pad_length);
+            writer.U31(payload_.push_promise.promised_stream_id);
+            break;
+        case Frame::TYPE_PING_FRAME : writer.U64(payload_.ping.opaque_data); break;
+        case Frame::TYPE_GOAWAY_FRAME :
+            writer.U31(payload_.goaway.last_stream_id);
+            writer.U32(payload_.goaway.error_code);
+            break;
+        case Frame::TYPE_WINDOW_UPDATE_FRAME : writer.U31(payload_.window_update.window_size_increment); break;
+        default : break;
+    }
+
+    BufferChain chain;
+    chain.Append(prefix);
+    if(bytes_.Empty() == false) chain.Append(bytes_);
+    if(pad_length() > 0) chain.Append(padding, pad_length());
+
+    return chain;
+}
+
+hpack::Table::DECODE_STATUS FrameValue::DecodeHeaderBlock(hpack::Table& hpack_table, hpack::HeaderBlock& block) const {
+    return hpack_table.DecodeFragment(block, bytes_.Address(), bytes_.Length(), has_flags(Frame::FLAG_END_HEADERS));
+}
+
+// Octets of the payload in front of the variable length part.
+uint32_t FrameValue::PrefixLength() const {
+    uint32_t len = 0;
+
+    switch(type_) {
+        case Frame::TYPE_DATA_FRAME :
+        case Frame::TYPE_HEADERS_FRAME :
+            if(has_flags(Frame::FLAG_PADDED)) len = len + 1;
+            if(type_ == Frame::TYPE_HEADERS_FRAME && has_flags(Frame::FLAG_PRIORITY)) len = len + 5;
+            break;
+        case Frame::TYPE_PRIORITY_FRAME : len = 5; break;
+        case Frame::TYPE_RST_STREAM_FRAME : len = 4; break;
+        case Frame::TYPE_SETTINGS_FRAME :
+            if(has_flags(Frame::FLAG_ACK) == false) len = SettingsFrame::SettingsLength(payload_.settings.values);
+            break;
+        case Frame::TYPE_PUSH_PROMISE_FRAME : len = has_flags(Frame::FLAG_PADDED) ? 5 : 4; break;
+        case Frame::TYPE_PING_FRAME : len = 8; break;
+        case Frame::TYPE_GOAWAY_FRAME : len = 8; break;
+        case Frame::TYPE_WINDOW_UPDATE_FRAME : len = 4; break;
+        default : break;
+    }
+
+    return len;
+}
+
+void FrameValue::UpdateLength() {
+    length_ = PrefixLength() + bytes_.Length() + pad_length();
+}
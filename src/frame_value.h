@@ -0,0 +1,158 @@
+#ifndef _LHTTP2_FRAME_VALUE_H_
+#define _LHTTP2_FRAME_VALUE_H_
+
+#include <stdint.h>
+
+#include "frame.h"
+#include "settings.h"
+#include "buffer/buffer_chain.h"
+#include "buffer/buffer_slice.h"
+#include "hpack/hpack.h"
+#include "hpack/header_block.h"
+
+namespace lhttp2 {
+    /*
+        ### Frame value ###
+
+        Value type holding a frame of any type, the counterpart of the Frame
+        class family without virtual dispatch or a heap allocation per frame.
+        The frame header is followed by a tagged union of the fixed payload
+        fields, dispatch is a switch on type().
+
+            switch(value.type()) {
+                case Frame::TYPE_PING_FRAME : ...; break;
+                case Frame::TYPE_SETTINGS_FRAME : ...; break;
+            }
+
+        Variable length parts (the data of DATA, header block fragments, the
+        debug data of GOAWAY) are a BufferSlice of the received payload, so
+        decoding copies nothing and control frames cost no allocation at all.
+        Payload accessors are only meaningful for the types they belong to.
+
+        Header blocks are left encoded. DecodeHeaderBlock() runs the fragment
+        through the hpack table, which has to happen in order of arrival; the
+        views of a block taken from a single fragment point into the value.
+    */
+    class FrameValue {
+    public:
+        FrameValue();
+
+        static FrameValue MakeData(uint32_t stream_id, const BufferSlice& data, uint8_t pad_length = 0);
+        static FrameValue MakeHeaders(uint32_t stream_id, const BufferSlice& header_block_fragment, uint8_t pad_length = 0);
+        static FrameValue MakePriority(uint32_t stream_id, bool exclusive, uint32_t stream_dependency, uint8_t weight);
+        static FrameValue MakeRSTStream(uint32_t stream_id, uint32_t error_code);
+        static FrameValue MakeSettings(const lhttp2::Settings& settings);
+        static FrameValue MakeSettingsAck();
+        static FrameValue MakePushPromise(uint32_t stream_id, uint32_t promised_stream_id, const BufferSlice& header_block_fragment, uint8_t pad_length = 0);
+        static FrameValue MakePing(uint64_t opaque_data, bool ack = false);
+        static FrameValue MakeGoaway(uint32_t last_stream_id, uint32_t error_code, const BufferSlice& additional_debug_data = BufferSlice());
+        static FrameValue MakeWindowUpdate(uint32_t stream_id, uint32_t window_size_increment);
+        static FrameValue MakeContinuation(uint32_t stream_id, const BufferSlice& header_block_fragment);
+
+        const uint32_t length() const;
+        const Frame::FRAME_TYPE type() const;
+        const uint8_t flags() const;
+        const uint32_t stream_id() const;
+        const bool reserved() const;
+
+        void set_flags(uint8_t flags);
+        void clear_flags(uint8_t flags);
+        bool has_flags(uint8_t flags) const;
+
+        // DATA, HEADERS, PUSH_PROMISE
+        const uint8_t pad_length() const;
+
+        // HEADERS with the PRIORITY flag, PRIORITY
+        const bool exclusive() const;
+        const uint32_t stream_dependency() const;
+        const uint8_t weight() const;
+        void set_priority(bool exclusive, uint32_t stream_dependency, uint8_t weight);
+
+        // RST_STREAM, GOAWAY
+        const uint32_t error_code() const;
+
+        // SETTINGS, parameters the frame does not carry hold their defaults.
+        const lhttp2::Settings& settings() const;
+        bool has_parameter(SettingsFrame::SETTINGS_PARAMETERS id) const;
+        // Sets the parameters the frame carries in settings, the others keep their values (RFC 7540 6.5.3).
+        void Apply(lhttp2::Settings& settings) const;
+
+        const uint32_t promised_stream_id() const;
+        const uint64_t opaque_data() const;
+        const uint32_t last_stream_id() const;
+        const uint32_t window_size_increment() const;
+
+        // DATA
+        const BufferSlice& data() const;
+        // HEADERS, PUSH_PROMISE, CONTINUATION
+        const BufferSlice& header_block_fragment() const;
+        // GOAWAY
+        const BufferSlice& additional_debug_data() const;
+
+        // Decodes a FRAME_HEADER_LENGTH octet header and its payload into this value,
+        // false if the type is unknown or the payload is malformed.
+        bool Decode(const char* header, const BufferSlice& payload);
+
+        // Frame header and payload as they go on the wire, taken from the BufferPool.
+        BufferChain Encode() const;
+
+        // Feeds the header block fragment to the decoder, END_HEADERS completes the block.
+        hpack::Table::DECODE_STATUS DecodeHeaderBlock(hpack::Table& hpack_table, hpack::HeaderBlock& block) const;
+
+    private:
+        FrameValue(Frame::FRAME_TYPE type, uint32_t stream_id);
+
+        uint32_t PrefixLength() const;
+        void UpdateLength();
+
+        uint32_t length_ = 0;
+        Frame::FRAME_TYPE type_ = Frame::TYPE_SETTINGS_FRAME;
+        uint8_t flags_ = 0;
+        uint32_t stream_id_ = 0;
+        bool reserved_ = false;
+
+        // Data, header block fragment or debug data, depending on the type.
+        BufferSlice bytes_;
+
+        union Payload {
+            Payload() : ping{0} {}
+
+            // DATA and PRIORITY use a part of these.
+            struct {
+                uint8_t pad_length;
+                bool exclusive;
+                uint32_t stream_dependency;
+                uint8_t weight;
+            } headers;
+
+            struct {
+                uint8_t pad_length;
+                uint32_t promised_stream_id;
+            } push_promise;
+
+            struct {
+                uint32_t error_code;
+            } rst_stream;
+
+            struct {
+                lhttp2::Settings values;
+                uint8_t parameters;     // bit 1 << id for every parameter carried
+            } settings;
+
+            struct {
+                uint64_t opaque_data;
+            } ping;
+
+            struct {
+                uint32_t last_stream_id;
+                uint32_t error_code;
+            } goaway;
+
+            struct {
+                uint32_t window_size_increment;
+            } window_update;
+        } payload_;
+    };
+};
+
+#endif
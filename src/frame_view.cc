@@ -0,0 +1,303 @@
+#include "frame_view.h"
+#include "buffer/byte_cursor.h"
+
+using namespace lhttp2;
+
+static inline uint32_t Load31(const char* p) {
+    return (uint32_t)byte_order::Load<4>(p) & 0x7FFFFFFF;
+}
+
+/*
+    Implementation of FrameView
+*/
+FrameView::FrameView() {
+}
+
+FrameView::FrameView(const char* buff, const uint32_t len) : buff_(buff), len_(len) {
+}
+
+bool FrameView::Complete() const {
+    return len_ >= FRAME_HEADER_LENGTH && len_ - FRAME_HEADER_LENGTH >= length();
+}
+
+const uint32_t FrameView::size() const {
+    return FRAME_HEADER_LENGTH + length();
+}
+
+const uint32_t FrameView::length() const {
+    return (uint32_t)byte_order::Load<3>(buff_);
+}
+
+const Frame::FRAME_TYPE FrameView::type() const {
+    return (Frame::FRAME_TYPE)(uint8_t)buff_[3];
+}
+
+const uint8_t FrameView::flags() const {
+    return (uint8_t)buff_[4];
+}
+
+const uint32_t FrameView::stream_id() const {
+    return Load31(buff_ + 5);
+}
+
+const bool FrameView::reserved() const {
+    return ((uint8_t)buff_[5] & 0x80) == 0x80;
+}
+
+bool FrameView::has_flags(uint8_t flags) const {
+    return (this->flags() & flags) == flags;
+}
+
+const char* FrameView::header() const {
+    return buff_;
+}
+
+const char* FrameView::payload() const {
+    return buff_ + FRAME_HEADER_LENGTH;
+}
+
+/*
+    Implementation of FramePayloadView
+*/
+FramePayloadView::FramePayloadView(const char* payload, const uint32_t len, const uint8_t flags) : buff_(payload), len_(len), flags_(flags) {
+}
+
+FramePayloadView::FramePayloadView(const FrameView& frame) : FramePayloadView(frame.payload(), frame.length(), frame.flags()) {
+}
+
+const char* FramePayloadView::payload() const {
+    return buff_;
+}
+
+const uint32_t FramePayloadView::length() const {
+    return len_;
+}
+
+bool FramePayloadView::has_flags(uint8_t flags) const {
+    return (flags_ & flags) == flags;
+}
+
+/*
+    Implementation of DataView
+*/
+bool DataView::Valid() const {
+    if(has_flags(Frame::FLAG_PADDED) == false) return true;
+    return len_ >= 1 && len_ - 1 >= pad_length();
+}
+
+const uint8_t DataView::pad_length() const {
+    return has_flags(Frame::FLAG_PADDED) ? (uint8_t)buff_[0] : 0;
+}
+
+const char* DataView::data() const {
+    return has_flags(Frame::FLAG_PADDED) ? buff_ + 1 : buff_;
+}
+
+const uint32_t DataView::data_length() const {
+    return has_flags(Frame::FLAG_PADDED) ? len_ - 1 - pad_length() : len_;
+}
+
+/*
+    Implementation of HeadersView
+*/
+bool HeadersView::Valid() const {
+    return len_ >= PrefixLength() && len_ - PrefixLength() >= pad_length();
+}
+
+const uint8_t HeadersView::pad_length() const {
+    return (has_flags(Frame::FLAG_PADDED) && len_ >= 1) ? (uint8_t)buff_[0] : 0;
+}
+
+const bool HeadersView::exclusive() const {
+    if(has_flags(Frame::FLAG_PRIORITY) == false) return false;
+    return ((uint8_t)buff_[has_flags(Frame::FLAG_PADDED) ? 1 : 0] & 0x80) == 0x80;
+}
+
+const uint32_t HeadersView::stream_dependency() const {
+    if(has_flags(Frame::FLAG_PRIORITY) == false) return 0;
+    return Load31(buff_ + (has_flags(Frame::FLAG_PADDED) ? 1 : 0));
+}
+
+const uint8_t HeadersView::weight() const {
+    if(has_flags(Frame::FLAG_PRIORITY) == false) return 16;
+    return (uint8_t)buff_[has_flags(Frame::FLAG_PADDED) ? 5 : 4];
+}
+
+const char* HeadersView::header_block_fragment() const {
+    return buff_ + PrefixLength();
+}
+
+const uint32_t HeadersView::header_block_fragment_length() const {
+    return len_ - PrefixLength() - pad_length();
+}
+
+uint32_t HeadersView::PrefixLength() const {
+    return (has_flags(Frame::FLAG_PADDED) ? 1 : 0) + (has_flags(Frame::FLAG_PRIORITY) ? 5 : 0);
+}
+
+/*
+    Implementation of PriorityView
+*/
+bool PriorityView::Valid() const {
+    return len_ == 5;
+}
+
+const bool PriorityView::exclusive() const {
+    return ((uint8_t)buff_[0] & 0x80) == 0x80;
+}
+
+const uint32_t PriorityView::stream_dependency() const {
+    return Load31(buff_);
+}
+
+const uint8_t PriorityView::weight() const {
+    return (uint8_t)buff_[4];
+}
+
+/*
+    Implementation of RSTStreamView
+*/
+bool RSTStreamView::Valid() const {
+    return len_ == 4;
+}
+
+const uint32_t RSTStreamView::error_code() const {
+    return (uint32_t)byte_order::Load<4>(buff_);
+}
+
+/*
+    Implementation of SettingsView
+*/
+// An acknowledgement carries no parameters (RFC 7540 6.5).
+bool SettingsView::Valid() const {
+    if(has_flags(Frame::FLAG_ACK)) return len_ == 0;
+    return len_ % 6 == 0;
+}
+
+const uint32_t SettingsView::count() const {
+    return len_ / 6;
+}
+
+const uint16_t SettingsView::id(const uint32_t i) const {
+    return (uint16_t)byte_order::Load<2>(buff_ + i * 6);
+}
+
+const uint32_t SettingsView::value(const uint32_t i) const {
+    return (uint32_t)byte_order::Load<4>(buff_ + i * 6 + 2);
+}
+
+void SettingsView::Decode(lhttp2::Settings& settings) const {
+    uint32_t i, id, val, set_cnt = count();
+
+    for(i = 0; i < set_cnt; i++) {
+        id = this->id(i);
+        val = value(i);
+
+        if(id == SettingsFrame::SETTINGS_HEADER_TABLE_SIZE) settings.set_header_table_size(val);
+        else if(id == SettingsFrame::SETTINGS_ENABLE_PUSH) settings.set_enable_push(val);
+        else if(id == SettingsFrame::SETTINGS_MAX_CONCURRENT_STREAMS) settings.set_max_concurrent_stream(val);
+        else if(id == SettingsFrame::SETTINGS_INITIAL_WINDOW_SIZE) settings.set_initial_window_size(val);
+        else if(id == SettingsFrame::SETTINGS_MAX_FRAME_SIZE) {
+            if(val < 0x4000) val = 0x4000;
+            if(val > 0xFFFFFF) val = 0xFFFFFF;
+            settings.set_max_frame_size(val);
+        }
+        else if(id == SettingsFrame::SETTINGS_MAX_HEADER_LIST_SIZE) settings.set_max_header_list_size(val);
+    }
+}
+
+uint8_t SettingsView::parameters() const {
+    uint32_t i, id, set_cnt = count();
+    uint8_t parameters = 0;
+
+    for(i = 0; i < set_cnt; i++) {
+        id = this->id(i);
+        if(id >= SettingsFrame::SETTINGS_HEADER_TABLE_SIZE && id <= SettingsFrame::SETTINGS_MAX_HEADER_LIST_SIZE) parameters = parameters | (1 << id);
+    }
+
+    return parameters;
+}
+
+/*
+    Implementation of PushPromiseView
+*/
+bool PushPromiseView::Valid() const {
+    uint32_t prefix_len = has_flags(Frame::FLAG_PADDED) ? 5 : 4;
+    return len_ >= prefix_len && len_ - prefix_len >= pad_length();
+}
+
+const uint8_t PushPromiseView::pad_length() const {
+    return (has_flags(Frame::FLAG_PADDED) && len_ >= 1) ? (uint8_t)buff_[0] : 0;
+}
+
+const uint32_t PushPromiseView::promised_stream_id() const {
+    return Load31(buff_ + (has_flags(Frame::FLAG_PADDED) ? 1 : 0));
+}
+
+const char* PushPromiseView::header_block_fragment() const {
+    return buff_ + (has_flags(Frame::FLAG_PADDED) ? 5 : 4);
+}
+
+const uint32_t PushPromiseView::header_block_fragment_length() const {
+    return len_ - (has_flags(Frame::FLAG_PADDED) ? 5 : 4) - pad_length();
+}
+
+/*
+    Implementation of PingView
+*/
+bool PingView::Valid() const {
+    return len_ == 8;
+}
+
+const uint64_t PingView::opaque_data() const {
+    return byte_order::Load<8>(buff_);
+}
+
+/*
+    Implementation of GoawayView
+*/
+bool GoawayView::Valid() const {
+    return len_ >= 8;
+}
+
+const uint32_t GoawayView::last_stream_id() const {
+    return Load31(buff_);
+}
+
+const uint32_t GoawayView::error_code() const {
+    return (uint32_t)byte_order::Load<4>(buff_ + 4);
+}
+
+const char* GoawayView::additional_debug_data() const {
+    return buff_ + 8;
+}
+
+const uint32_t GoawayView::additional_debug_data_length() const {
+    return len_ - 8;
+}
+
+/*
+    Implementation of WindowUpdateView
+*/
+bool WindowUpdateView::Valid() const {
+    return len_ == 4;
+}
+
+const uint32_t WindowUpdateView::window_size_increment() const {
+    return Load31(buff_);
+}
+
+/*
+    Implementation of ContinuationView
+*/
+bool ContinuationView::Valid() const {
+    return true;
+}
+
+const char* ContinuationView::header_block_fragment() const {
+    return buff_;
+}
+
+const uint32_t ContinuationView::header_block_fragment_length() const {
+    return len_;
+}
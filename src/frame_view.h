@@ -0,0 +1,186 @@
+#ifndef _LHTTP2_FRAME_VIEW_H_
+#define _LHTTP2_FRAME_VIEW_H_
+
+#include <stdint.h>
+
+#include "frame.h"
+#include "settings.h"
+
+namespace lhttp2 {
+    /*
+        ### Frame views ###
+
+        Read-only views decoding a frame lazily from bytes owned by someone
+        else, typically the receive buffer. Nothing is copied or allocated; an
+        accessor reads its field from the wire form each time it is called.
+        The bytes must stay untouched while a view is in use.
+
+        FrameView covers the 9-octet header, which is enough to route a frame
+        by type and stream. The payload views are built from a FrameView, or
+        from a bare payload and the flags of its frame. Valid() checks the
+        payload against its fixed layout and padding; the other accessors of a
+        payload view assume it returned true.
+    */
+    class FrameView {
+    public:
+        FrameView();
+
+        // buff starts with a frame header, len counts the bytes available from there.
+        FrameView(const char* buff, const uint32_t len);
+
+        // Whether the header and the whole payload lie within the bytes.
+        bool Complete() const;
+
+        // Header and payload octets.
+        const uint32_t size() const;
+
+        const uint32_t length() const;
+        const Frame::FRAME_TYPE type() const;
+        const uint8_t flags() const;
+        const uint32_t stream_id() const;
+        const bool reserved() const;
+        bool has_flags(uint8_t flags) const;
+
+        const char* header() const;
+        const char* payload() const;
+
+    private:
+        const char* buff_ = nullptr;
+        uint32_t len_ = 0;
+    };
+
+    class FramePayloadView {
+    public:
+        FramePayloadView(const char* payload, const uint32_t len, const uint8_t flags);
+        FramePayloadView(const FrameView& frame);
+
+        const char* payload() const;
+        const uint32_t length() const;
+        bool has_flags(uint8_t flags) const;
+
+    protected:
+        const char* buff_;
+        uint32_t len_;
+        uint8_t flags_;
+    };
+
+    class DataView : public FramePayloadView {
+    public:
+        using FramePayloadView::FramePayloadView;
+
+        bool Valid() const;
+
+        const uint8_t pad_length() const;
+        const char* data() const;
+        const uint32_t data_length() const;
+    };
+
+    class HeadersView : public FramePayloadView {
+    public:
+        using FramePayloadView::FramePayloadView;
+
+        bool Valid() const;
+
+        const uint8_t pad_length() const;
+        const bool exclusive() const;
+        const uint32_t stream_dependency() const;
+        const uint8_t weight() const;
+        const char* header_block_fragment() const;
+        const uint32_t header_block_fragment_length() const;
+
+    private:
+        uint32_t PrefixLength() const;
+    };
+
+    class PriorityView : public FramePayloadView {
+    public:
+        using FramePayloadView::FramePayloadView;
+
+        bool Valid() const;
+
+        const bool exclusive() const;
+        const uint32_t stream_dependency() const;
+        const uint8_t weight() const;
+    };
+
+    class RSTStreamView : public FramePayloadView {
+    public:
+        using FramePayloadView::FramePayloadView;
+
+        bool Valid() const;
+
+        const uint32_t error_code() const;
+    };
+
+    class SettingsView : public FramePayloadView {
+    public:
+        using FramePayloadView::FramePayloadView;
+
+        bool Valid() const;
+
+        // Parameters in order of appearance, an identifier may repeat.
+        const uint32_t count() const;
+        const uint16_t id(const uint32_t i) const;
+        const uint32_t value(const uint32_t i) const;
+
+        // Applies the parameters on top of settings, the others keep their values.
+        void Decode(lhttp2::Settings& settings) const;
+
+        // Bit 1 << id for every known parameter present, unknown ones are ignored (RFC 7540 6.5.2).
+        uint8_t parameters() const;
+    };
+
+    class PushPromiseView : public FramePayloadView {
+    public:
+        using FramePayloadView::FramePayloadView;
+
+        bool Valid() const;
+
+        const uint8_t pad_length() const;
+        const uint32_t promised_stream_id() const;
+        const char* header_block_fragment() const;
+        const uint32_t header_block_fragment_length() const;
+    };
+
+    class PingView : public FramePayloadView {
+    public:
+        using FramePayloadView::FramePayloadView;
+
+        bool Valid() const;
+
+        const uint64_t opaque_data() const;
+    };
+
+    class GoawayView : public FramePayloadView {
+    public:
+        using FramePayloadView::FramePayloadView;
+
+        bool Valid() const;
+
+        const uint32_t last_stream_id() const;
+        const uint32_t error_code() const;
+        const char* additional_debug_data() const;
+        const uint32_t additional_debug_data_length() const;
+    };
+
+    class WindowUpdateView : public FramePayloadView {
+    public:
+        using FramePayloadView::FramePayloadView;
+
+        bool Valid() const;
+
+        const uint32_t window_size_increment() const;
+    };
+
+    class ContinuationView : public FramePayloadView {
+    public:
+        using FramePayloadView::FramePayloadView;
+
+        bool Valid() const;
+
+        const char* header_block_fragment() const;
+        const uint32_t header_block_fragment_length() const;
+    };
+};
+
+#endif
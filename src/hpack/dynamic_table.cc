@@ -0,0 +1,324 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "dynamic_table.h"
+
+using namespace hpack;
+
+// FNV-1a, the value hash continues from the name hash after a separator octet.
+static uint32_t HashBytes(uint32_t hash, const char* buff, uint32_t len) {
+    for(uint32_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)buff[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t HashName(const char* name, uint32_t name_len) {
+    return HashBytes(2166136261u, name, name_len);
+}
+
+static uint32_t HashField(uint32_t name_hash, const char* value, uint32_t value_len) {
+    return HashBytes((name_hash ^ 0xff) * 16777619u, value, value_len);
+}
+
+HeaderKey::HeaderKey(const char* name, uint32_t name_len, const char* value, uint32_t value_len) : name(name), name_len(name_len), value(value), value_len(value_len) {
+    name_hash = HashName(name, name_len);
+    field_hash = HashField(name_hash, value, value_len);
+}
+
+DynamicTable::DynamicTable(uint32_t max_size) : max_size_(max_size) {
+}
+
+DynamicTable::~DynamicTable() {
+    free(entries_);
+    free(field_index_);
+    free(name_index_);
+    free(arena_);
+}
+
+bool DynamicTable::Insert(const char* name, uint32_t name_len, const char* value, uint32_t value_len) {
+    uint64_t entry_size = (uint64_t)name_len + value_len + HEADER_ENTRY_OVERHEAD;
+
+    if(entry_size > max_size_) {
+        Clear();
+        inserted_++;
+        return true;
+    }
+
+    while(size_ + entry_size > max_size_) {
+        Evict();
+    }
+
+    uint32_t len = name_len + value_len;
+    char* copy = nullptr;
+
+    if(count_ == EntriesCapacity() && GrowEntries() == false) return false;
+
+    if(arena_end_ + len > arena_cap_ || arena_ == nullptr) {
+        // The name (an indexed name) or the value may point into the arena itself,
+        // so move them out of the way before compaction shifts the bytes around.
+        if((name >= arena_ && name < arena_ + arena_cap_) || (value >= arena_ && value < arena_ + arena_cap_)) {
+            copy = (char *)malloc(len + 1);
+            if(copy == nullptr) return false;
+            memcpy(copy, name, name_len);
+            memcpy(copy + name_len, value, value_len);
+            name = copy;
+            value = copy + name_len;
+        }
+        Compact();
+
+        if(arena_end_ + len > arena_cap_ / 2 && (uint64_t)arena_cap_ < 2 * (uint64_t)max_size_ && GrowArena(arena_end_ + len) == false) {
+            free(copy);
+            return false;
+        }
+    }
+
+    uint32_t pos = (first_ + count_) & entries_mask_;
+    Entry& entry = entries_[pos];
+    entry.offset = arena_end_;
+    entry.name_len = name_len;
+    entry.value_len = value_len;
+    entry.name_hash = HashName(name, name_len);
+    entry.field_hash = HashField(entry.name_hash, value, value_len);
+
+    memcpy(arena_ + arena_end_, name, name_len);
+    memcpy(arena_ + arena_end_ + name_len, value, value_len);
+    arena_end_ = arena_end_ + len;
+    free(copy);
+
+    count_++;
+    IndexInsert(field_index_, entry.field_hash, pos, true);
+    IndexInsert(name_index_, entry.name_hash, pos, false);
+    size_ = size_ + entry_size;
+    inserted_++;
+    return true;
+}
+
+bool DynamicTable::Get(uint32_t idx, const char*& name, uint32_t& name_len, const char*& value, uint32_t& value_len) const {
+    if(idx >= count_) return false;
+
+    const Entry& entry = entries_[(first_ + count_ - 1 - idx) & entries_mask_];
+    name = arena_ + entry.offset;
+    name_len = entry.name_len;
+    value = name + entry.name_len;
+    value_len = entry.value_len;
+    return true;
+}
+
+bool DynamicTable::Find(const HeaderKey& key, uint32_t& idx, bool& value_match) const {
+    value_match = false;
+    if(count_ == 0) return false;
+
+    int64_t pos = IndexFind(field_index_, key, true);
+    value_match = pos >= 0;
+    if(pos < 0) pos = IndexFind(name_index_, key, false);
+    if(pos < 0) return false;
+
+    idx = count_ - 1 - ((pos - first_) & entries_mask_);
+    return true;
+}
+
+void DynamicTable::SetMaxSize(uint32_t max_size) {
+    while(size_ > max_size) {
+        Evict();
+    }
+
+    max_size_ = max_size;
+}
+
+void DynamicTable::Clear() {
+    first_ = 0;
+    count_ = 0;
+    arena_end_ = 0;
+    size_ = 0;
+    if(field_index_ == nullptr) return;
+
+    memset(field_index_, 0, sizeof(IndexSlot) * (index_mask_ + 1));
+    memset(name_index_, 0, sizeof(IndexSlot) * (index_mask_ + 1));
+}
+
+uint32_t DynamicTable::Size() const {
+    return size_;
+}
+
+uint32_t DynamicTable::MaxSize() const {
+    return max_size_;
+}
+
+uint32_t DynamicTable::Count() const {
+    return count_;
+}
+
+uint64_t DynamicTable::Inserted() const {
+    return inserted_;
+}
+
+void DynamicTable::Evict() {
+    if(count_ == 0) return;
+
+    const Entry& entry = entries_[first_];
+    IndexRemove(field_index_, entry.field_hash, first_);
+    IndexRemove(name_index_, entry.name_hash, first_);
+    size_ = size_ - (entry.name_len + entry.value_len + HEADER_ENTRY_OVERHEAD);
+    first_ = (first_ + 1) & entries_mask_;
+    count_--;
+}
+
+uint32_t DynamicTable::EntriesCapacity() const {
+    return (entries_ != nullptr) ? entries_mask_ + 1 : 0;
+}
+
+// Doubles the ring, the entries move to its start in order and are indexed anew.
+bool DynamicTable::GrowEntries() {
+    uint32_t entries_cap = (entries_ != nullptr) ? 2 * (entries_mask_ + 1) : DYNAMIC_TABLE_ENTRIES_MIN;
+
+    // The indexes are kept at most half full.
+    Entry* entries = (Entry *)malloc(sizeof(Entry) * entries_cap);
+    IndexSlot* field_index = (IndexSlot *)malloc(sizeof(IndexSlot) * 2 * entries_cap);
+    IndexSlot* name_index = (IndexSlot *)malloc(sizeof(IndexSlot) * 2 * entries_cap);
+
+    if(entries == nullptr || field_index == nullptr || name_index == nullptr) {
+        free(entries);
+        free(field_index);
+        free(name_index);
+        return false;
+    }
+
+    for(uint32_t i = 0; i < count_; i++) {
+        entries[i] = entries_[(first_ + i) & entries_mask_];
+    }
+
+    free(entries_);
+    free(field_index_);
+    free(name_index_);
+
+    entries_ = entries;
+    entries_mask_ = entries_cap - 1;
+    first_ = 0;
+    field_index_ = field_index;
+    name_index_ = name_index;
+    index_mask_ = 2 * entries_cap - 1;
+
+    Reindex();
+    return true;
+}
+
+/*
+    Called on a compacted arena which would be more than half full with the
+    next entry. It doubles, up to twice the table size, so that compaction is
+    needed at most once per max_size inserted octets once the table is full.
+*/
+bool DynamicTable::GrowArena(uint32_t needed) {
+    uint64_t arena_cap = (arena_cap_ > 0) ? 2 * (uint64_t)arena_cap_ : DYNAMIC_TABLE_ARENA_MIN;
+
+    if(arena_cap < 2 * (uint64_t)needed) arena_cap = 2 * (uint64_t)needed;
+    if(arena_cap > 2 * (uint64_t)max_size_) arena_cap = 2 * (uint64_t)max_size_;
+    if(arena_cap < needed) arena_cap = needed;
+
+    char* arena = (char *)realloc(arena_, arena_cap);
+    if(arena == nullptr) return false;
+
+    arena_ = arena;
+    arena_cap_ = arena_cap;
+    return true;
+}
+
+void DynamicTable::Compact() {
+    if(count_ == 0) {
+        arena_end_ = 0;
+        return;
+    }
+
+    uint32_t base = entries_[first_].offset;
+    if(base == 0) return;
+
+    memmove(arena_, arena_ + base, arena_end_ - base);
+    arena_end_ = arena_end_ - base;
+
+    for(uint32_t i = 0; i < count_; i++) {
+        entries_[(first_ + i) & entries_mask_].offset -= base;
+    }
+}
+
+bool DynamicTable::SameKey(uint32_t a, uint32_t b, bool by_value) const {
+    const Entry& entry_a = entries_[a];
+    const Entry& entry_b = entries_[b];
+
+    if(entry_a.name_len != entry_b.name_len) return false;
+    if(by_value == true && entry_a.value_len != entry_b.value_len) return false;
+
+    uint32_t len = entry_a.name_len + (by_value == true ? entry_a.value_len : 0);
+    return memcmp(arena_ + entry_a.offset, arena_ + entry_b.offset, len) == 0;
+}
+
+void DynamicTable::IndexInsert(IndexSlot* index, uint32_t hash, uint32_t pos, bool by_value) {
+    uint32_t i = hash & index_mask_;
+
+    while(index[i].pos != 0) {
+        // A newer entry with the same key takes over the slot.
+        if(index[i].hash == hash && SameKey(index[i].pos - 1, pos, by_value) == true) {
+            index[i].pos = pos + 1;
+            return;
+        }
+        i = (i + 1) & index_mask_;
+    }
+
+    index[i].hash = hash;
+    index[i].pos = pos + 1;
+}
+
+void DynamicTable::IndexRemove(IndexSlot* index, uint32_t hash, uint32_t pos) {
+    uint32_t i = hash & index_mask_, j, home;
+
+    while(index[i].pos != pos + 1) {
+        if(index[i].pos == 0) return;
+        i = (i + 1) & index_mask_;
+    }
+
+    // Backward shift deletion: move later slots of the probe sequence into the
+    // hole unless their home slot lies cyclically between the hole and them.
+    j = i;
+    while(true) {
+        j = (j + 1) & index_mask_;
+        if(index[j].pos == 0) break;
+
+        home = index[j].hash & index_mask_;
+        if(i <= j ? (i < home && home <= j) : (i < home || home <= j)) continue;
+
+        index[i] = index[j];
+        i = j;
+    }
+    index[i].pos = 0;
+}
+
+int64_t DynamicTable::IndexFind(const IndexSlot* index, const HeaderKey& key, bool by_value) const {
+    uint32_t hash = by_value == true ? key.field_hash : key.name_hash;
+    uint32_t i = hash & index_mask_;
+
+    while(index[i].pos != 0) {
+        if(index[i].hash == hash) {
+            const Entry& entry = entries_[index[i].pos - 1];
+            const char* name = arena_ + entry.offset;
+
+            if(entry.name_len == key.name_len && memcmp(name, key.name, key.name_len) == 0) {
+                if(by_value == false) return index[i].pos - 1;
+                if(entry.value_len == key.value_len && memcmp(name + entry.name_len, key.value, key.value_len) == 0) return index[i].pos - 1;
+            }
+        }
+        i = (i + 1) & index_mask_;
+    }
+
+    return -1;
+}
+
+void DynamicTable::Reindex() {
+    memset(field_index_, 0, sizeof(IndexSlot) * (index_mask_ + 1));
+    memset(name_index_, 0, sizeof(IndexSlot) * (index_mask_ + 1));
+
+    // Oldest first, so that the newest duplicate ends up in the index.
+    for(uint32_t i = 0; i < count_; i++) {
+        uint32_t pos = (first_ + i) & entries_mask_;
+        IndexInsert(field_index_, entries_[pos].field_hash, pos, true);
+        IndexInsert(name_index_, entries_[pos].name_hash, pos, false);
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef _HPACK_DYNAMIC_TABLE_H_
+#define _HPACK_DYNAMIC_TABLE_H_
+
+#include <stdint.h>
+
+// RFC 7541 4.1: the size of an entry is the length of its name and value plus 32 octets.
+#define HEADER_ENTRY_OVERHEAD 32
+
+// Storage is grown from these as entries are inserted.
+#define DYNAMIC_TABLE_ENTRIES_MIN 8
+#define DYNAMIC_TABLE_ARENA_MIN 256
+
+namespace hpack {
+    /*
+        Header field prepared for table lookups. The name and value are hashed
+        once when the key is built and the hashes are reused for every table
+        the field is looked up in.
+    */
+    struct HeaderKey {
+    public:
+        HeaderKey(const char* name, uint32_t name_len, const char* value, uint32_t value_len);
+
+        const char* name;
+        uint32_t name_len;
+        const char* value;
+        uint32_t value_len;
+        uint32_t name_hash;     // name only
+        uint32_t field_hash;    // name and value
+    };
+
+    /*
+        ### Dynamic table ###
+
+        HPACK dynamic table kept as a ring of fixed size entry records. Names and
+        values are stored back to back in a single byte arena in insertion order,
+        so the live bytes always form one contiguous run which starts at the
+        oldest entry. Insertion and eviction from the tail are O(1); the arena is
+        compacted only when the write position reaches its end, which is at most
+        once per max_size inserted octets. Ring and arena start empty and double
+        as entries are inserted, the arena up to twice max_size, so a table the
+        peer never fills costs next to nothing.
+
+        Entries are addressed by their HPACK relative index, 0 being the newest.
+        Pointers returned by Get() stay valid until the next Insert() or SetMaxSize().
+
+        Two open addressing hash indexes, one keyed by name and value and one by
+        name alone, map to the ring position of the newest matching entry. They
+        are updated on every insertion and eviction, so Find() costs one probe
+        sequence instead of a scan over the table. Since entries are evicted
+        oldest first, an evicted entry is only still indexed when no newer entry
+        with the same key exists and can be dropped from the index outright.
+    */
+    class DynamicTable {
+    public:
+        DynamicTable(uint32_t max_size);
+        ~DynamicTable();
+
+        DynamicTable(const DynamicTable& a) = delete;
+        void operator=(const DynamicTable& a) = delete;
+
+        // Evicts from the tail until the new entry fits. An entry larger than the
+        // whole table empties it and is not inserted. false if storage could not
+        // be grown, the table has lost entries then and must not be used further.
+        bool Insert(const char* name, uint32_t name_len, const char* value, uint32_t value_len);
+        bool Get(uint32_t idx, const char*& name, uint32_t& name_len, const char*& value, uint32_t& value_len) const;
+
+        // Relative index of the newest entry matching the key, by name and value
+        // if there is one (value_match is set) and by name otherwise.
+        bool Find(const HeaderKey& key, uint32_t& idx, bool& value_match) const;
+
+        void SetMaxSize(uint32_t max_size);
+        void Clear();
+
+        uint32_t Size() const;
+        uint32_t MaxSize() const;
+        uint32_t Count() const;
+
+        // Number of entries inserted so far. Entry number n (counting from 0) is
+        // at relative index Inserted() - 1 - n while it is still in the table.
+        uint64_t Inserted() const;
+
+    private:
+        struct Entry {
+            uint32_t offset;
+            uint32_t name_len;
+            uint32_t value_len;
+            uint32_t name_hash;
+            uint32_t field_hash;
+        };
+
+        // pos is the ring position of the entry plus one, 0 marks a free slot.
+        struct IndexSlot {
+            uint32_t hash;
+            uint32_t pos;
+        };
+
+        void Evict();
+        uint32_t EntriesCapacity() const;
+        bool GrowEntries();
+        bool GrowArena(uint32_t needed);
+        void Compact();
+
+        bool SameKey(uint32_t a, uint32_t b, bool by_value) const;
+        void IndexInsert(IndexSlot* index, uint32_t hash, uint32_t pos, bool by_value);
+        void IndexRemove(IndexSlot* index, uint32_t hash, uint32_t pos);
+        int64_t IndexFind(const IndexSlot* index, const HeaderKey& key, bool by_value) const;
+        void Reindex();
+
+        Entry* entries_ = nullptr;
+        uint32_t entries_mask_ = 0;
+        uint32_t first_ = 0;
+        uint32_t count_ = 0;
+
+        IndexSlot* field_index_ = nullptr;
+        IndexSlot* name_index_ = nullptr;
+        uint32_t index_mask_ = 0;
+
+        char* arena_ = nullptr;
+        uint32_t arena_cap_ = 0;
+        uint32_t arena_end_ = 0;
+
+        uint32_t size_ = 0;
+        uint32_t max_size_ = 0;
+        uint64_t inserted_ = 0;
+    };
+}
+
+#endif
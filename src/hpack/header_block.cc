@@ -0,0 +1,105 @@
+#include <cstring>
+
+#include "header_block.h"
+
+using namespace hpack;
+
+bool HeaderFieldView::NameEquals(const char* str, uint32_t str_len) const {
+    return name_len == str_len && memcmp(name, str, str_len) == 0;
+}
+
+std::string HeaderFieldView::Name() const {
+    return std::string(name, name_len);
+}
+
+std::string HeaderFieldView::Value() const {
+    return std::string(value, value_len);
+}
+
+HeaderBlock::HeaderBlock(lhttp2::MemoryResource* resource) : resource_(resource != nullptr ? resource : lhttp2::NewDeleteResource()), fields_(lhttp2::PolymorphicAllocator<HeaderFieldView>(resource_)) {
+}
+
+HeaderBlock::~HeaderBlock() {
+    Chunk* chunk;
+
+    while(chunks_ != nullptr) {
+        chunk = chunks_;
+        chunks_ = chunk->next;
+        resource_->Deallocate(chunk, sizeof(Chunk) + chunk->size);
+    }
+}
+
+uint32_t HeaderBlock::Count() const {
+    return fields_.size();
+}
+
+const HeaderFieldView& HeaderBlock::operator[](uint32_t i) const {
+    return fields_[i];
+}
+
+const HeaderFieldView* HeaderBlock::Find(const char* name, uint32_t name_len) const {
+    for(uint32_t i = 0; i < fields_.size(); i++) {
+        if(fields_[i].NameEquals(name, name_len) == true) return &fields_[i];
+    }
+    return nullptr;
+}
+
+const HeaderFieldView* HeaderBlock::Find(const char* name) const {
+    return Find(name, strlen(name));
+}
+
+void HeaderBlock::Clear() {
+    Chunk *chunk, *largest = chunks_;
+
+    fields_.clear();
+    if(chunks_ == nullptr) return;
+
+    // Only the largest chunk is kept, so a block which needed more scratch
+    // than that once gets it in a single chunk next time around.
+    for(chunk = chunks_; chunk != nullptr; chunk = chunk->next) {
+        if(chunk->size > largest->size) largest = chunk;
+    }
+    while(chunks_ != nullptr) {
+        chunk = chunks_;
+        chunks_ = chunk->next;
+        if(chunk != largest) resource_->Deallocate(chunk, sizeof(Chunk) + chunk->size);
+    }
+
+    largest->next = nullptr;
+    chunks_ = largest;
+    cursor_ = (char *)(largest + 1);
+    end_ = cursor_ + largest->size;
+}
+
+char* HeaderBlock::Allocate(uint32_t len) {
+    if(cursor_ == nullptr || len > (uint32_t)(end_ - cursor_)) {
+        uint64_t size = HEADER_BLOCK_CHUNK_SIZE;
+        while(size < len) size = size * 2;
+        if(size > UINT32_MAX) size = len;
+
+        Chunk* chunk = (Chunk *)resource_->Allocate(sizeof(Chunk) + size);
+        if(chunk == nullptr) return nullptr;
+
+        chunk->next = chunks_;
+        chunk->size = size;
+        chunks_ = chunk;
+        cursor_ = (char *)(chunk + 1);
+        end_ = cursor_ + size;
+    }
+
+    char* p = cursor_;
+    cursor_ = cursor_ + len;
+    return p;
+}
+
+char* HeaderBlock::Copy(const char* str, uint32_t len) {
+    char* p = Allocate(len);
+    if(p == nullptr) return nullptr;
+
+    memcpy(p, str, len);
+    return p;
+}
+
+void HeaderBlock::Push(const HeaderFieldView& field) {
+    fields_.push_back(field);
+}
@@ -0,0 +1,86 @@
+#ifndef _HPACK_HEADER_BLOCK_H_
+#define _HPACK_HEADER_BLOCK_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "../memory/memory_resource.h"
+
+#define HEADER_BLOCK_CHUNK_SIZE 1024
+
+namespace hpack {
+    /*
+        Non-owning header field produced by Table::Decode(HeaderBlock&, ...).
+        name and value are not null terminated.
+    */
+    struct HeaderFieldView {
+    public:
+        const char* name;
+        uint32_t name_len;
+        const char* value;
+        uint32_t value_len;
+        uint8_t type;               // HeaderField::HEADER_FIELD_TYPE
+        bool name_use_huffman;
+        bool value_use_huffman;
+
+        bool NameEquals(const char* str, uint32_t str_len) const;
+        std::string Name() const;
+        std::string Value() const;
+    };
+
+    /*
+        ### Header block ###
+
+        Result of decoding one header block into views. Literal strings which are
+        not Huffman coded point straight into the encoded block, fields indexed
+        from the static table point into the static table. Huffman coded strings
+        and strings taken from the dynamic table, which may be evicted by a later
+        insertion, are placed into a scratch area owned by the block.
+
+        The views stay valid until Clear(), the next decode into the same block or
+        the destruction of the block, as long as the encoded block itself is kept
+        alive as well. A block decoded from several fragments copies every string
+        into the scratch area, so it does not depend on the fragments. The scratch
+        area is kept for reuse across blocks.
+    */
+    class HeaderBlock {
+    public:
+        HeaderBlock(lhttp2::MemoryResource* resource = nullptr);
+        ~HeaderBlock();
+
+        HeaderBlock(const HeaderBlock& a) = delete;
+        void operator=(const HeaderBlock& a) = delete;
+
+        uint32_t Count() const;
+        const HeaderFieldView& operator[](uint32_t i) const;
+
+        // First field with the name, nullptr if there is none.
+        const HeaderFieldView* Find(const char* name, uint32_t name_len) const;
+        const HeaderFieldView* Find(const char* name) const;
+
+        void Clear();
+
+    private:
+        friend class Table;
+
+        struct Chunk {
+            struct Chunk* next;
+            uint32_t size;
+        };
+
+        // Scratch space, nullptr if a new chunk cannot be allocated.
+        char* Allocate(uint32_t len);
+        char* Copy(const char* str, uint32_t len);
+        void Push(const HeaderFieldView& field);
+
+        lhttp2::MemoryResource* resource_;
+        std::vector<HeaderFieldView, lhttp2::PolymorphicAllocator<HeaderFieldView>> fields_;
+
+        Chunk* chunks_ = nullptr;
+        char* cursor_ = nullptr;
+        char* end_ = nullptr;
+    };
+}
+
+#endif
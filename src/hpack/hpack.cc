@@ -1,353 +1,635 @@
 #include <stdint.h>
 #include <cstdlib>
+#include <cstring>
 #include <string>
 #include <iostream>
 
 #include "hpack.h"
 #include "huffman.h"
+#include "header_block.h"
+#include "static_table.h"
 
 using namespace hpack;
 
-static const struct HeaderField static_table[STATIC_TABLE_SIZE] = {
-    {"", ""},                               // 0
-    {":authority", ""},                     // 1
-    {":method", "GET"},                     // 2
-    {":method", "POST"},                    // 3
-    {":path", "/"},                         // 4
-    {":path", "/index.html"},               // 5
-    {":scheme", "http"},                    // 6
-    {":scheme", "https"},                   // 7
-    {":status", "200"},                     // 8
-    {":status", "204"},                     // 9
-    {":status", "206"},                     // 10
-    {":status", "304"},                     // 11
-    {":status", "400"},                     // 12
-    {":status", "404"},                     // 13
-    {":status", "500"},                     // 14
-    {"accept-charset", ""},                 // 15
-    {"accept-encoding", "gzip, deflate"},   // 16
-    {"accept-language", ""},                // 17
-    {"accept-ranges", ""},                  // 18
-    {"accept", ""},                         // 19
-    {"access-control-allow-origin", ""},    // 20
-    {"age", ""},                            // 21
-    {"allow", ""},                          // 22
-    {"authorization", ""},                  // 23
-    {"cache-control", ""},                  // 24
-    {"content-disposition", ""},            // 25
-    {"content-encoding", ""},               // 26
-    {"content-language", ""},               // 27
-    {"content-length", ""},                 // 28
-    {"content-location", ""},               // 29
-    {"content-range", ""},                  // 30
-    {"content-type", ""},                   // 31
-    {"cookie", ""},                         // 32
-    {"date", ""},                           // 33
-    {"etag", ""},                           // 34
-    {"expect", ""},                         // 35
-    {"expires", ""},                        // 36
-    {"from", ""},                           // 37
-    {"host", ""},                           // 38
-    {"if-match", ""},                       // 39
-    {"if-modified-since", ""},              // 40
-    {"if-none-match", ""},                  // 41
-    {"if-range", ""},                       // 42
-    {"if-unmodified-since", ""},            // 43
-    {"last-modified", ""},                  // 44
-    {"link", ""},                           // 45
-    {"location", ""},                       // 46
-    {"max-forwards", ""},                   // 47
-    {"proxy-authenticate", ""},             // 48
-    {"proxy-authorization", ""},            // 49
-    {"range", ""},                          // 50
-    {"referer", ""},                        // 51
-    {"refresh", ""},                        // 52
-    {"retry-after", ""},                    // 53
-    {"server", ""},                         // 54
-    {"set-cookie", ""},                     // 55
-    {"strict-transport-security", ""},      // 56
-    {"transfer-encoding", ""},              // 57
-    {"user-agend", ""},                     // 58
-    {"vary", ""},                           // 59
-    {"via", ""},                            // 60
-    {"www-authenticate", ""},               // 61
-};
-
 static const uint8_t prefix_max[] = {0, 1, 3, 7, 15, 31, 63, 127, 255};
 
-static void EncodeInteger(Buffer& buff, uint32_t i, uint8_t prefix_length, uint8_t prefix_dummy) {
-    if(prefix_length <= 0 || prefix_length > 8) {
-        buff.Clear();
-        return;
-    }
+// A 32 bit integer takes the prefix octet and at most 5 continuation octets.
+#define INTEGER_ENCODED_LENGTH_MAX 6
+
+static uint32_t EncodeInteger(char* out, uint32_t i, uint8_t prefix_length, uint8_t prefix_dummy) {
+    uint32_t idx = 0;
 
     if(i < prefix_max[prefix_length]) {
-        buff.Resize(1);
-        buff.Set((prefix_dummy & ~prefix_max[prefix_length]) | i, 0);
+        out[idx++] = (prefix_dummy & ~prefix_max[prefix_length]) | i;
+        return idx;
     }
-    else {
-        int idx = 1;
-        buff.Resize(2 + (i - prefix_max[prefix_length]) / 128);
-        buff.Set((prefix_dummy & ~prefix_max[prefix_length]) | prefix_max[prefix_length], 0);
-        i = i - prefix_max[prefix_length];
-        while(i >= 128) {
-            buff.Set(i % 128 + 128, idx++);
-            i = i / 128;
-        }
-        buff.Set(i, idx);
+
+    out[idx++] = (prefix_dummy & ~prefix_max[prefix_length]) | prefix_max[prefix_length];
+    i = i - prefix_max[prefix_length];
+    while(i >= 128) {
+        out[idx++] = i % 128 + 128;
+        i = i / 128;
     }
+    out[idx++] = i;
+    return idx;
 }
 
-static uint32_t DecodeInteger(const Buffer& buff, uint32_t& offset, uint8_t prefix_length) {
-    if(prefix_length <= 0 || prefix_length > 8) {
-        return 0;
+// Huffman coding is used whenever it is shorter than the raw string, so a
+// string never takes more than its raw length plus the length prefix.
+static uint32_t EncodeString(char* out, const std::string& str) {
+    uint32_t idx, huff_len = Huffman::EncodedLength(str.data(), str.length());
+
+    if(huff_len < str.length()) {
+        idx = EncodeInteger(out, huff_len, 7, 0x80);
+        return idx + Huffman::Encode(out + idx, str.data(), str.length());
+    }
+
+    idx = EncodeInteger(out, str.length(), 7, 0);
+    memcpy(out + idx, str.data(), str.length());
+    return idx + str.length();
+}
+
+static bool DecodeInteger(const char* buff, const uint32_t len, uint32_t& offset, uint8_t prefix_length, uint32_t& value) {
+    if(prefix_length <= 0 || prefix_length > 8 || offset >= len) {
+        return false;
     }
 
-    uint32_t i = buff.Get(offset++) & prefix_max[prefix_length];
+    uint32_t i = (uint8_t)buff[offset++] & prefix_max[prefix_length];
+    uint8_t b;
 
     if(i >= prefix_max[prefix_length]) {
-        uint32_t p = 1;
+        uint32_t shift = 0;
         do {
-            if(offset >= buff.Length()) {
-                return 0;
+            // More than 28 bits of continuation does not fit into 32 bits.
+            if(offset >= len || shift > 21) {
+                return false;
             }
-            i = i + (buff.Get(offset & 127)) * p;
-            p = p * 128;
-        } while((buff.Get(offset++) & 128) == 128);
+            b = buff[offset++];
+            i = i + ((uint32_t)(b & 127) << shift);
+            shift = shift + 7;
+        } while((b & 128) == 128);
     }
 
-    return i;
+    value = i;
+    return true;
 }
 
-static void AppendToTable(std::vector<HeaderField>& dynamic_table, uint32_t dynamic_table_size_max, HeaderField header) {
-    std::vector<HeaderField>::iterator it;
-    it = dynamic_table.begin();
-    dynamic_table.insert(it, header);
-    
-    while(dynamic_table.size() > dynamic_table_size_max) {
-        dynamic_table.pop_back();
-    }
+static bool AppendToTable(DynamicTable& dynamic_table, const HeaderField& header) {
+    return dynamic_table.Insert(header.Name().data(), header.Name().length(), header.Value().data(), header.Value().length());
 }
 
-static uint32_t FindFromTable(std::vector<HeaderField>& dynamic_table, std::string name, std::string value) {
-    uint32_t i, total_size = STATIC_TABLE_SIZE + dynamic_table.size();
-    bool compare_value = false;
-    HeaderField header;
+static bool GetFromTable(const DynamicTable& dynamic_table, uint32_t idx, std::string* name, std::string* value) {
+    const char *name_ptr, *value_ptr;
+    uint32_t name_len, value_len;
 
-    if(value.compare("") != 0)
-        compare_value = true;
+    if(dynamic_table.Get(idx, name_ptr, name_len, value_ptr, value_len) == false) return false;
+    if(name != nullptr) name->assign(name_ptr, name_len);
+    if(value != nullptr) value->assign(value_ptr, value_len);
+    return true;
+}
 
-    for(i = 1; i < total_size; i++) {
-        if(i < STATIC_TABLE_SIZE) header = static_table[i];
-        else header = dynamic_table[i - STATIC_TABLE_SIZE];
-        if(header.Name().compare(name) == 0) {
-            if(compare_value == false || (compare_value == true && header.Value().compare(value) == 0)) {
-                return i;
-            }
-        }
-    }
+/*
+    Implementation of header field
+*/
+HeaderField::HeaderField() : name_use_huffman_(false), value_use_huffman_(false) {
+}
 
-    return 0;
+HeaderField::HeaderField(std::string name, std::string value) : name_use_huffman_(false), value_use_huffman_(false), name_(name), value_(value) {
 }
 
-bool Table::Encode(Buffer& encoded_buffer, std::vector<HeaderFieldRepresentation> header_list, bool update) {
-    uint32_t idx;
-    Buffer encode_int, huff;
-    std::vector<HeaderFieldRepresentation>::iterator it = header_list.begin();
-    std::vector<HeaderField>& update_table = dynamic_table_;
+HeaderField::HeaderField(bool name_use_huffman, bool value_use_huffman, std::string name, std::string value) : name_use_huffman_(name_use_huffman), value_use_huffman_(value_use_huffman), name_(name), value_(value) {
+}
+
+bool HeaderField::NameUseHuffman() const {
+    return name_use_huffman_;
+}
+
+bool HeaderField::ValueUseHuffman() const {
+    return value_use_huffman_;
+}
+
+bool HeaderField::SetNameUseHuffman(bool use) {
+    name_use_huffman_ = use;
+    return name_use_huffman_;
+}
+
+bool HeaderField::SetValueUseHuffman(bool use) {
+    value_use_huffman_ = use;
+    return value_use_huffman_;
+}
+
+const std::string& HeaderField::Name() const {
+    return name_;
+}
+
+const std::string& HeaderField::Value() const {
+    return value_;
+}
+
+void HeaderField::SetName(const std::string name) {
+    name_ = name;
+}
+
+void HeaderField::SetValue(const std::string value) {
+    value_ = value;
+}
+
+HeaderField& HeaderFieldRepresentation::Field() {
+    return header_field_;
+}
+
+HeaderField::HEADER_FIELD_TYPE& HeaderFieldRepresentation::Type() {
+    return type_;
+}
+
+const HeaderField& HeaderFieldRepresentation::Field() const {
+    return header_field_;
+}
 
-    if(update == false) {
-        std::vector<HeaderField> temp_table = dynamic_table_;
-        update_table = temp_table;
+HeaderField::HEADER_FIELD_TYPE HeaderFieldRepresentation::Type() const {
+    return type_;
+}
+
+/*
+    Implementation of table
+*/
+Table::Table(uint32_t dynamic_table_size_max) : dynamic_table_(dynamic_table_size_max), table_size_limit_(dynamic_table_size_max) {
+}
+
+double Table::Stats::HitRate() const {
+    if(fields == 0) return 0.0;
+    return (double)indexed / (double)fields;
+}
+
+double Table::Stats::CompressionRatio() const {
+    if(raw_bytes == 0) return 0.0;
+    return (double)encoded_bytes / (double)raw_bytes;
+}
+
+void Table::SetIndexingPolicy(IndexingPolicy* policy) {
+    policy_ = (policy != nullptr) ? policy : &default_policy_;
+}
+
+const Table::Stats& Table::GetStats() const {
+    return stats_;
+}
+
+void Table::ResetStats() {
+    stats_ = Stats();
+}
+
+void Table::UpdateStats(const HeaderKey& key, uint32_t idx, bool indexed, bool inserted, uint32_t encoded_len) {
+    stats_.fields++;
+    if(indexed == true) stats_.indexed++;
+    else if(idx > 0) stats_.name_indexed++;
+    if(inserted == true) stats_.inserted++;
+    stats_.raw_bytes = stats_.raw_bytes + key.name_len + key.value_len;
+    stats_.encoded_bytes = stats_.encoded_bytes + encoded_len;
+}
+
+bool Table::Encode(Buffer& encoded_buffer, const std::vector<HeaderFieldRepresentation>& header_list, bool update_table) {
+    uint32_t encoded_len = 0;
+
+    encoded_buffer.Resize(MaxEncodedLength(header_list));
+    if(encoded_buffer.Length() == 0) return true;
+
+    bool result = Encode(&encoded_buffer[0], encoded_buffer.Length(), encoded_len, header_list.data(), header_list.size(), update_table);
+    encoded_buffer.Resize(encoded_len);
+    return result;
+}
+
+bool Table::Encode(char* out, const uint32_t out_len, uint32_t& encoded_len, const HeaderFieldRepresentation* header_list, const size_t count, bool update_table) {
+    uint32_t idx, offset = 0;
+    bool value_match;
+    HeaderField::HEADER_FIELD_TYPE type;
+
+    encoded_len = 0;
+    if(out_len < MaxEncodedLength(header_list, count)) return false;
+
+    // A size change since the last block is signalled at the start of this one, the
+    // smallest size in between first so the decoder evicts what we did (RFC 7541 4.2).
+    if(update_table == true && size_update_pending_ == true) {
+        if(size_update_min_ < dynamic_table_.MaxSize())
+            offset = offset + EncodeInteger(out + offset, size_update_min_, 5, 0x20);
+        offset = offset + EncodeInteger(out + offset, dynamic_table_.MaxSize(), 5, 0x20);
+        size_update_pending_ = false;
     }
 
-    encoded_buffer.Clear();
+    for(size_t i = 0; i < count; i++) {
+        const HeaderField& field = header_list[i].Field();
+        HeaderKey key(field.Name().data(), field.Name().length(), field.Value().data(), field.Value().length());
+        uint32_t start = offset;
 
-    for(; it != header_list.end(); it++) {
-        if(it->Type() == HeaderField::INDEXED_HEADER_FIELD) {
-            idx = Find(it->Field().Name(), it->Field().Value());
-            if(idx == 0) {
-                it->Type() = HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING;
-                it--;
+        if(update_table == true) policy_->Observe(key);
+
+        idx = Find(key, value_match);
+        type = header_list[i].Type();
+
+        if(type == HeaderField::INDEXED_HEADER_FIELD) {
+            if(value_match == true) {
+                offset = offset + EncodeInteger(out + offset, idx, 7, 0x80);
+                if(update_table == true) UpdateStats(key, idx, true, false, offset - start);
                 continue;
             }
-            EncodeInteger(encode_int, idx, 7, 0x80);
-            encoded_buffer.Append(encode_int);
-        }
-        else {
-            idx = Find(it->Field().Name(), "");
-            if(idx == 0) {
-                if(it->Type() == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING)
-                    encoded_buffer.Append(0x40);
-                else if(it->Type() == HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING)
-                    encoded_buffer.Append(0x00);
-                else if(it->Type() == HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED)
-                    encoded_buffer.Append(0x10);
-                
-                if(it->Field().NameUseHuffman() == true) {
-                    Huffman::GetInstance().Encode(huff, it->Field().Name().length());
-                    EncodeInteger(encode_int, huff.Length(), 7, 0x80);
-                    encoded_buffer.Append(encode_int);
-                    encoded_buffer.Append(huff);
-                }
-                else {
-                    EncodeInteger(encode_int, it->Field().Name().length(), 7, 0);
-                    encoded_buffer.Append(encode_int);
-                    encoded_buffer.Append(it->Field().Name().c_str());
-                }
-            } else {
-                if(it->Type() == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING)
-                    EncodeInteger(encode_int, idx, 6, 0x40);
-                else if(it->Type() == HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING)
-                    EncodeInteger(encode_int, idx, 4, 0x00);
-                else if(it->Type() == HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED)
-                    EncodeInteger(encode_int, idx, 4, 0x10);
-                encoded_buffer.Append(encode_int);
-            }
 
-            if(it->Field().ValueUseHuffman() == true) {
-                Huffman::GetInstance().Encode(huff, it->Field().Value().length());
-                EncodeInteger(encode_int, huff.Length(), 7, 0x80);
-                encoded_buffer.Append(encode_int);
-                encoded_buffer.Append(huff);
-            }
-            else {
-                EncodeInteger(encode_int, it->Field().Value().length(), 7, 0);
-                encoded_buffer.Append(encode_int);
-                encoded_buffer.Append(it->Field().Value().c_str());
+            switch(policy_->Decide(key, dynamic_table_)) {
+                case IndexingPolicy::INDEX: type = HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING; break;
+                case IndexingPolicy::NEVER_INDEX: type = HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED; break;
+                default: type = HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING; break;
             }
         }
+
+        if(type == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING)
+            offset = offset + EncodeInteger(out + offset, idx, 6, 0x40);
+        else if(type == HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING)
+            offset = offset + EncodeInteger(out + offset, idx, 4, 0x00);
+        else if(type == HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED)
+            offset = offset + EncodeInteger(out + offset, idx, 4, 0x10);
+
+        if(idx == 0)
+            offset = offset + EncodeString(out + offset, field.Name());
+        offset = offset + EncodeString(out + offset, field.Value());
+
+        // The decoder inserts the field as soon as it reads it, so the encoder
+        // table has to follow along for later indexes to line up.
+        if(update_table == true) {
+            if(type == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING && AppendToTable(dynamic_table_, field) == false)
+                return false;
+            UpdateStats(key, idx, false, type == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING, offset - start);
+        }
     }
 
+    encoded_len = offset;
     return true;
 }
 
+uint32_t Table::MaxEncodedLength(const std::vector<HeaderFieldRepresentation>& header_list) {
+    return MaxEncodedLength(header_list.data(), header_list.size());
+}
+
+uint32_t Table::MaxEncodedLength(const HeaderFieldRepresentation* header_list, const size_t count) {
+    // Room for the Dynamic Table Size Updates which may start the block.
+    uint64_t len = 2 * INTEGER_ENCODED_LENGTH_MAX;
+
+    for(size_t i = 0; i < count; i++) {
+        const HeaderField& field = header_list[i].Field();
+
+        // Representation with index, then the name and value strings with their lengths.
+        len = len + INTEGER_ENCODED_LENGTH_MAX;
+        len = len + INTEGER_ENCODED_LENGTH_MAX + field.Name().length();
+        len = len + INTEGER_ENCODED_LENGTH_MAX + field.Value().length();
+    }
+
+    return len > UINT32_MAX ? UINT32_MAX : len;
+}
+
 bool Table::Decode(std::vector<HeaderFieldRepresentation>& header_list, const Buffer& buff, bool update_table) {
-    uint32_t offset = 0, idx, name_len, value_len;
-    bool name_huff, value_huff;
-    char first;
-    Buffer name, value;
+    decoding_ = false;
+    return DecodeFragment(header_list, buff.Address(), buff.Length(), true, update_table) == DECODE_COMPLETE;
+}
 
+bool Table::Decode(HeaderBlock& block, const char* buff, const uint32_t len, bool update_table) {
+    decoding_ = false;
+    return DecodeFragment(block, buff, len, true, update_table) == DECODE_COMPLETE;
+}
+
+Table::DECODE_STATUS Table::DecodeFragment(HeaderBlock& block, const char* buff, const uint32_t len, bool end_headers, bool update_table) {
+    DECODE_STATUS status = DECODE_COMPLETE;
+    const char* data = buff;
+    uint32_t data_len = len, offset = 0;
+    bool first = (decoding_ == false);
+
+    if(first == true) {
+        block.Clear();
+        pending_.Clear();
+        header_list_size_ = 0;
+        decoding_ = true;
+    }
+
+    // A representation cut by the previous fragment is completed from this one.
+    if(pending_.Length() > 0) {
+        pending_.Append(buff, len);
+        data = pending_.Address();
+        data_len = pending_.Length();
+    }
+
+    // Raw strings may only point into a block which arrived in one piece.
+    bool copy = (first == false || end_headers == false);
+
+    while(offset < data_len) {
+        status = Scan(data, data_len, offset);
+        if(status != DECODE_COMPLETE) break;
+
+        if(DecodeField(block, data, data_len, offset, copy, update_table) == false) {
+            status = DECODE_COMPRESSION_ERROR;
+            break;
+        }
+
+        // Huffman coded strings are only known exactly once decoded.
+        if(header_list_size_ > max_header_list_size_) {
+            status = DECODE_HEADER_LIST_TOO_LARGE;
+            break;
+        }
+    }
+
+    if(status == DECODE_INCOMPLETE) {
+        if(end_headers == true) status = DECODE_COMPRESSION_ERROR;
+        else pending_ = Buffer(data + offset, data_len - offset);
+    }
+    else if(status == DECODE_COMPLETE) {
+        pending_.Clear();
+        if(end_headers == false) status = DECODE_INCOMPLETE;
+    }
+
+    if(status != DECODE_INCOMPLETE) {
+        pending_.Clear();
+        decoding_ = false;
+    }
+
+    decode_status_ = status;
+    return status;
+}
+
+Table::DECODE_STATUS Table::DecodeFragment(std::vector<HeaderFieldRepresentation>& header_list, const char* buff, const uint32_t len, bool end_headers, bool update_table) {
     HeaderFieldRepresentation header;
+    DECODE_STATUS status = DecodeFragment(scratch_, buff, len, end_headers, update_table);
+
+    if(status == DECODE_COMPLETE || status == DECODE_INCOMPLETE) {
+        for(uint32_t i = 0; i < scratch_.Count(); i++) {
+            header.Field().SetName(scratch_[i].Name());
+            header.Field().SetValue(scratch_[i].Value());
+            header.Field().SetNameUseHuffman(scratch_[i].name_use_huffman);
+            header.Field().SetValueUseHuffman(scratch_[i].value_use_huffman);
+            header.Type() = (HeaderField::HEADER_FIELD_TYPE)scratch_[i].type;
+            header_list.push_back(header);
+        }
+    }
+
+    // The fields are owned by the list now, so the scratch is reused for the next fragment.
+    scratch_.Clear();
+    return status;
+}
 
-    while(offset < buff.Length()) {
-        first = buff.Get(offset);
+bool Table::Decoding() const {
+    return decoding_;
+}
 
-        // Indexed Header Field
-        if((first & 0x80) == 0x80) {
-            idx = DecodeInteger(buff, offset, 7);
+Table::DECODE_STATUS Table::DecodeStatus() const {
+    return decode_status_;
+}
 
-            if(idx == 0) {
-                return false;
-            }
+void Table::SetMaxHeaderListSize(uint32_t size) {
+    max_header_list_size_ = size;
+}
 
-            if(idx < STATIC_TABLE_SIZE) {
-                header.Field().SetName(static_table[idx].Name());
-                header.Field().SetValue(static_table[idx].Value());
-            }
-            else {
-                if(idx - STATIC_TABLE_SIZE >= dynamic_table_.size()) return false;
-                header.Field().SetName(dynamic_table_[idx - STATIC_TABLE_SIZE].Name());
-                header.Field().SetValue(dynamic_table_[idx - STATIC_TABLE_SIZE].Value());
-            }
-            header.Type() = HeaderField::INDEXED_HEADER_FIELD;
+// Whether the integer at offset ends within len. Integers longer than any valid
+// one count as complete, so that DecodeInteger() rejects them.
+static bool IntegerComplete(const char* buff, const uint32_t len, uint32_t offset, uint8_t prefix_length) {
+    if(offset >= len) return false;
+    if(((uint8_t)buff[offset] & prefix_max[prefix_length]) < prefix_max[prefix_length]) return true;
+
+    for(uint32_t i = 1; offset + i < len; i++) {
+        if(i >= INTEGER_ENCODED_LENGTH_MAX || (buff[offset + i] & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+/*
+    Checks the representation at offset before it is decoded: whether it is
+    complete within buff and whether it still fits into the header list. The
+    size check uses the lengths as soon as they are read, a Huffman coded string
+    counting with the fewest octets it can decode to, so an oversized field is
+    refused before its strings arrive.
+*/
+Table::DECODE_STATUS Table::Scan(const char* buff, const uint32_t len, uint32_t offset) {
+    uint8_t first = buff[offset], prefix_length;
+    uint32_t idx, name_len, value_len;
+    uint64_t field_len = 0;
+    DECODE_STATUS status;
+
+    // Maximum Dynamic Table Size Change
+    if((first & 0xe0) == 0x20) {
+        return IntegerComplete(buff, len, offset, 5) ? DECODE_COMPLETE : DECODE_INCOMPLETE;
+    }
+
+    // Indexed Header Field, small enough to be checked once decoded.
+    if((first & 0x80) == 0x80) {
+        return IntegerComplete(buff, len, offset, 7) ? DECODE_COMPLETE : DECODE_INCOMPLETE;
+    }
+
+    prefix_length = ((first & 0x40) == 0x40) ? 6 : 4;
+    if(IntegerComplete(buff, len, offset, prefix_length) == false) return DECODE_INCOMPLETE;
+    if(DecodeInteger(buff, len, offset, prefix_length, idx) == false) return DECODE_COMPRESSION_ERROR;
+
+    // Literal Header Field, the name is indexed or follows as a string.
+    if(idx > 0) {
+        if(EntryLength(idx, name_len, value_len) == false) return DECODE_COMPRESSION_ERROR;
+        field_len = name_len;
+    }
+    else {
+        if((status = ScanString(buff, len, offset, field_len)) != DECODE_COMPLETE) return status;
+    }
+
+    return ScanString(buff, len, offset, field_len);
+}
+
+// Skips the string at offset and adds the fewest octets it decodes to to field_len.
+Table::DECODE_STATUS Table::ScanString(const char* buff, const uint32_t len, uint32_t& offset, uint64_t& field_len) {
+    uint32_t code_len;
+
+    if(IntegerComplete(buff, len, offset, 7) == false) return DECODE_INCOMPLETE;
+
+    bool use_huffman = (buff[offset] & 0x80) == 0x80;
+    if(DecodeInteger(buff, len, offset, 7, code_len) == false) return DECODE_COMPRESSION_ERROR;
+
+    // The longest Huffman code has 30 bits.
+    field_len = field_len + (use_huffman ? (uint64_t)code_len * 8 / 30 : code_len);
+    if(header_list_size_ + field_len + HEADER_LIST_ENTRY_OVERHEAD > max_header_list_size_) return DECODE_HEADER_LIST_TOO_LARGE;
+
+    if(code_len > len - offset) return DECODE_INCOMPLETE;
+    offset = offset + code_len;
+    return DECODE_COMPLETE;
+}
+
+bool Table::EntryLength(uint32_t idx, uint32_t& name_len, uint32_t& value_len) {
+    if(idx == 0) return false;
+
+    if(idx < STATIC_TABLE_SIZE) {
+        const StaticEntry& entry = StaticTable::Get(idx);
+        name_len = entry.name_len;
+        value_len = entry.value_len;
+        return true;
+    }
+
+    const char *name, *value;
+    return dynamic_table_.Get(idx - STATIC_TABLE_SIZE, name, name_len, value, value_len);
+}
+
+bool Table::DecodeField(HeaderBlock& block, const char* buff, const uint32_t len, uint32_t& offset, bool copy, bool update_table) {
+    uint32_t idx;
+    char first = buff[offset];
+    HeaderFieldView field = HeaderFieldView();
+
+    // Indexed Header Field
+    if((first & 0x80) == 0x80) {
+        if(DecodeInteger(buff, len, offset, 7, idx) == false) return false;
+        if(LookupIndex(block, idx, field, true) == false) return false;
+        field.type = HeaderField::INDEXED_HEADER_FIELD;
+    }
+
+    // Maximum Dynamic Table Size Change
+    else if((first & 0xe0) == 0x20) {
+        uint32_t size;
+        if(DecodeInteger(buff, len, offset, 5, size) == false) return false;
+
+        // The peer may only pick a size up to our SETTINGS_HEADER_TABLE_SIZE (RFC 7541 6.3).
+        if(size > table_size_limit_) return false;
+        dynamic_table_.SetMaxSize(size);
+        return true;
+    }
+
+    // Literal Header Field
+    else {
+        // Literal Header Field with Incremental Indexing
+        if((first & 0x40) == 0x40) {
+            if(DecodeInteger(buff, len, offset, 6, idx) == false) return false;
+            field.type = HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING;
         }
-        
-        // Literal Header Field
+
+        // Literal Header Field Never Indexed
+        else if((first & 0x10) == 0x10) {
+            if(DecodeInteger(buff, len, offset, 4, idx) == false) return false;
+            field.type = HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED;
+        }
+
+        // Literal Header Field without Indexing
         else {
-            // Literal Header Field with Incremental Indexing
-            if((first & 0x40) == 0x40) {
-                idx = DecodeInteger(buff, offset, 6);
-                header.Type() = HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING;
-            }
+            if(DecodeInteger(buff, len, offset, 4, idx) == false) return false;
+            field.type = HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING;
+        }
 
-            // Maximum Dynamic Table Size Change
-            else if((first & 0x20) == 0x20) {
-                uint32_t size = DecodeInteger(buff, offset, 5);
-                UpdateSize(size);
-                continue;
-            }
+        if(idx > 0) {
+            if(LookupIndex(block, idx, field, false) == false) return false;
+        }
+        else {
+            if(DecodeString(block, buff, len, offset, field.name, field.name_len, field.name_use_huffman, copy) == false) return false;
+        }
 
-            // Literal Header Field Never Indexed
-            else if((first & 0x10) == 0x10) {
-                idx = DecodeInteger(buff, offset, 4);
-                header.Type() = HeaderField::LITERAL_HEADER_FIELD_NEVER_INDEXED;
-            }
+        if(DecodeString(block, buff, len, offset, field.value, field.value_len, field.value_use_huffman, copy) == false) return false;
+    }
 
-            // Literal Header Field without Indexing
-            else {
-                idx = DecodeInteger(buff, offset, 4);
-                header.Type() = HeaderField::LITERAL_HEADER_FIELD_WITHOUT_INDEXING;
-            }
+    block.Push(field);
+    header_list_size_ = header_list_size_ + field.name_len + field.value_len + HEADER_LIST_ENTRY_OVERHEAD;
 
-            if(idx > 0) {
-                if(idx < STATIC_TABLE_SIZE)
-                    header.Field().SetName(static_table[idx].Name());
-                else {
-                    if(idx - STATIC_TABLE_SIZE >= dynamic_table_.size()) return false;
-                    header.Field().SetName(dynamic_table_[idx - STATIC_TABLE_SIZE].Name);
-                }
-            }
-            else {
-                header.Field().SetNameUseHuffman((buff.Get(offset) & 128) == 128);
-                name_len = DecodeInteger(buff, offset, 7);
-                if(header.Field().NameUseHuffman() == true) {
-                    if(Huffman::GetInstance().Decode(name, Buffer(buff.Address(offset), name_len)) == false) return false;
-                    header.Field().SetName(std::string(name.Address(), name.Length()));
-                }
-                else {
-                    header.Field().SetName(std::string(buff.Address(offset), name_len));
-                }
-                offset = offset + name_len;
-            }
+    if(update_table == true && field.type == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING) {
+        if(dynamic_table_.Insert(field.name, field.name_len, field.value, field.value_len) == false) return false;
+    }
 
-            header.Field().SetValueUseHuffman((buff.Get(offset) & 128) == 128);
-            value_len = DecodeInteger(buff, offset, 7);
-            if(header.Field().ValueUseHuffman() == true) {
-                if(Huffman::GetInstance().Decode(value, Buffer(buff.Address(offset), value_len)) == false) return false;
-                header.Field().SetValue(std::string(value.Address(), value.Length()));
-            }
-            else {
-                header.Field().SetValue(std::string(buff.Address(offset), value_len));
-            }
-            offset = offset + value_len;
-        }
+    return true;
+}
 
-        header_list.push_back(header);
-        if(header.Type() == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING) {
-            AppendToTable(dynamic_table_, dynamic_table_size_max_, header.Field());
+bool Table::LookupIndex(HeaderBlock& block, uint32_t idx, HeaderFieldView& field, bool with_value) {
+    if(idx == 0) return false;
+
+    if(idx < STATIC_TABLE_SIZE) {
+        const StaticEntry& entry = StaticTable::Get(idx);
+        field.name = entry.name;
+        field.name_len = entry.name_len;
+        if(with_value == true) {
+            field.value = entry.value;
+            field.value_len = entry.value_len;
         }
+        return true;
     }
 
+    // Dynamic table storage moves on the next insertion, so the strings are copied.
+    const char *name, *value;
+    uint32_t name_len, value_len;
+
+    if(dynamic_table_.Get(idx - STATIC_TABLE_SIZE, name, name_len, value, value_len) == false) return false;
+    field.name = block.Copy(name, name_len);
+    field.name_len = name_len;
+    if(field.name == nullptr) return false;
+
+    if(with_value == true) {
+        field.value = block.Copy(value, value_len);
+        field.value_len = value_len;
+        if(field.value == nullptr) return false;
+    }
     return true;
 }
 
-void Table::Update(std::vector<HeaderFieldRepresentation> header_list) {
+bool Table::DecodeString(HeaderBlock& block, const char* buff, const uint32_t len, uint32_t& offset, const char*& str, uint32_t& str_len, bool& use_huffman, bool copy) {
+    uint32_t code_len;
+
+    if(offset >= len) return false;
+    use_huffman = (buff[offset] & 0x80) == 0x80;
+    if(DecodeInteger(buff, len, offset, 7, code_len) == false) return false;
+    if(code_len > len - offset) return false;
+
+    if(use_huffman == true) {
+        char* decoded = block.Allocate(Huffman::DecodedLengthMax(code_len));
+        if(decoded == nullptr) return false;
+        if(Huffman::Decode(decoded, str_len, buff + offset, code_len) == false) return false;
+        str = decoded;
+    }
+    else {
+        str = copy ? block.Copy(buff + offset, code_len) : buff + offset;
+        str_len = code_len;
+        if(str == nullptr) return false;
+    }
+
+    offset = offset + code_len;
+    return true;
+}
+
+bool Table::Update(std::vector<HeaderFieldRepresentation> header_list) {
     std::vector<HeaderFieldRepresentation>::iterator it = header_list.begin();
     for(; it != header_list.end(); it++) {
         if(it->Type() == HeaderField::LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING) {
-            Append(it->Field());
+            if(Append(it->Field()) == false) return false;
         }
     }
+    return true;
 }
 
 void Table::UpdateSize(uint32_t size) {
-    dynamic_table_size_max_ = size;
-    while(dynamic_table_.size() > dynamic_table_size_max_) {
-        dynamic_table_.pop_back();
+    if(size != dynamic_table_.MaxSize() || size_update_pending_ == true) {
+        if(size_update_pending_ == false || size < size_update_min_) size_update_min_ = size;
+        size_update_pending_ = true;
     }
+
+    table_size_limit_ = size;
+    dynamic_table_.SetMaxSize(size);
 }
 
 void Table::Print() {
-    for(uint32_t i = 0; i < dynamic_table_.size(); i++) {
-        std::cout << "(" << STATIC_TABLE_SIZE + i << ") " << dynamic_table_[i].Name() << ":" << dynamic_table_[i].Value() << std::endl;
+    std::string name, value;
+    for(uint32_t i = 0; i < dynamic_table_.Count(); i++) {
+        GetFromTable(dynamic_table_, i, &name, &value);
+        std::cout << "(" << STATIC_TABLE_SIZE + i << ") " << name << ":" << value << std::endl;
     }
+    std::cout << "size " << dynamic_table_.Size() << " / " << dynamic_table_.MaxSize() << std::endl;
 }
 
-void Table::Append(HeaderField header) {
-    AppendToTable(dynamic_table_, dynamic_table_size_max_, header);
+bool Table::Append(HeaderField header) {
+    return AppendToTable(dynamic_table_, header);
 }
 
-uint32_t Table::Find(const std::string name, const std::string value) {
-    return FindFromTable(dynamic_table_, name, value);
+uint32_t Table::Find(const HeaderKey& key, bool& value_match) {
+    uint32_t static_idx, dynamic_idx;
+    bool dynamic_value_match;
+
+    // A full match anywhere beats a name match, and the static table has the shorter indexes.
+    static_idx = StaticTable::Find(key, value_match);
+    if(value_match == true) return static_idx;
+
+    if(dynamic_table_.Find(key, dynamic_idx, dynamic_value_match) == true) {
+        if(dynamic_value_match == true || static_idx == 0) {
+            value_match = dynamic_value_match;
+            return STATIC_TABLE_SIZE + dynamic_idx;
+        }
+    }
+
+    return static_idx;
 }
\ No newline at end of file
@@ -1,13 +1,20 @@
 #ifndef _HPACK_H_
 #define _HPACK_H_
 
-#define STATIC_TABLE_SIZE 62
 #define DYNAMIC_TABLE_SIZE_MAX 4096
 
+// Every field counts 32 octets on top of its name and value (RFC 7540 6.5.2).
+#define HEADER_LIST_ENTRY_OVERHEAD 32
+
+#include <stdint.h>
 #include <vector>
 #include <string>
 
-#include "../buffer/Buffer.h"
+#include "../buffer/buffer.h"
+#include "dynamic_table.h"
+#include "header_block.h"
+#include "indexing_policy.h"
+#include "static_table.h"
 
 namespace hpack {
     struct HeaderField {
@@ -23,6 +30,8 @@ namespace hpack {
             HeaderField(std::string name, std::string value);
             HeaderField(bool name_use_huffman, bool value_use_huffman, std::string name, std::string value);
 
+            // Whether the strings arrived Huffman coded. The encoder ignores these
+            // and Huffman codes each string whenever that makes it shorter.
             bool NameUseHuffman() const;
             bool ValueUseHuffman() const;
 
@@ -46,28 +55,120 @@ namespace hpack {
         public:
             HeaderField& Field();
             HeaderField::HEADER_FIELD_TYPE& Type();
+            const HeaderField& Field() const;
+            HeaderField::HEADER_FIELD_TYPE Type() const;
 
         private:
             HeaderField header_field_;
-            HeaderField::HEADER_FIELD_TYPE type_;
+            HeaderField::HEADER_FIELD_TYPE type_ = HeaderField::INDEXED_HEADER_FIELD;
     };
 
     class Table {
     public:
-        bool Encode(Buffer& encoded_buffer, std::vector<HeaderFieldRepresentation> header_list, bool update_table = true);
+        // Encoder side statistics, counted for header blocks encoded with update_table set.
+        struct Stats {
+            uint64_t fields = 0;
+            uint64_t indexed = 0;           // sent as a single index
+            uint64_t name_indexed = 0;      // literal with an indexed name
+            uint64_t inserted = 0;          // literal added to the dynamic table
+            uint64_t raw_bytes = 0;         // name and value octets
+            uint64_t encoded_bytes = 0;     // octets of the representations
+
+            double HitRate() const;
+            double CompressionRatio() const;
+        };
+
+        typedef enum _DECODE_STATUS {
+            DECODE_COMPLETE = 0,                // the header block is complete
+            DECODE_INCOMPLETE,                  // waiting for the next fragment
+            DECODE_COMPRESSION_ERROR,           // malformed header block
+            DECODE_HEADER_LIST_TOO_LARGE,       // the block exceeds the max header list size
+        } DECODE_STATUS;
+
+        Table(uint32_t dynamic_table_size_max = DYNAMIC_TABLE_SIZE_MAX);
+
+        bool Encode(Buffer& encoded_buffer, const std::vector<HeaderFieldRepresentation>& header_list, bool update_table = true);
+
+        // Writes the header block in place, out must hold at least MaxEncodedLength() bytes.
+        bool Encode(char* out, const uint32_t out_len, uint32_t& encoded_len, const HeaderFieldRepresentation* header_list, const size_t count, bool update_table = true);
+
+        static uint32_t MaxEncodedLength(const std::vector<HeaderFieldRepresentation>& header_list);
+        static uint32_t MaxEncodedLength(const HeaderFieldRepresentation* header_list, const size_t count);
         bool Decode(std::vector<HeaderFieldRepresentation>& header_list, const Buffer& buff, bool update_table = true);
 
-        void Update(std::vector<HeaderFieldRepresentation> header_list);
+        // Zero-copy decode, see HeaderBlock for the lifetime of the resulting views.
+        bool Decode(HeaderBlock& block, const char* buff, const uint32_t len, bool update_table = true);
+
+        /*
+            Incremental decode of a header block split over a HEADERS or PUSH_PROMISE
+            frame and its CONTINUATION frames. Every fragment is decoded as it arrives,
+            only a field representation cut by the end of a fragment is held back
+            until the next one. The block variant collects the fields of all fragments,
+            the list variant appends the fields completed by each fragment.
+
+            Each representation is checked against the max header list size as soon
+            as its lengths are known, before its strings are read, buffered or Huffman
+            decoded. Once the limit is exceeded decoding stops right there and the
+            dynamic table no longer mirrors the peer's, so the connection has to be
+            closed. The same holds for DECODE_COMPRESSION_ERROR.
+
+            A complete block given to Decode() abandons a block still in progress.
+        */
+        DECODE_STATUS DecodeFragment(HeaderBlock& block, const char* buff, const uint32_t len, bool end_headers, bool update_table = true);
+        DECODE_STATUS DecodeFragment(std::vector<HeaderFieldRepresentation>& header_list, const char* buff, const uint32_t len, bool end_headers, bool update_table = true);
+
+        // Whether a header block is partially decoded, and the outcome of the last fragment.
+        bool Decoding() const;
+        DECODE_STATUS DecodeStatus() const;
+
+        // Limit on the decoded header list, UINT32_MAX leaves it unbounded.
+        void SetMaxHeaderListSize(uint32_t size);
+
+        bool Update(std::vector<HeaderFieldRepresentation> header_list);
+
+        // Sets the table size. On the decoder side it is our SETTINGS_HEADER_TABLE_SIZE
+        // and limits the size updates in decoded header blocks, a larger one is a
+        // DECODE_COMPRESSION_ERROR. On the encoder side it must not exceed the peer's,
+        // the change is signalled at the start of the next block encoded.
         void UpdateSize(uint32_t size);
 
         void Print();
 
-    private:
-        void Append(HeaderField header);
-        uint32_t Find(const std::string name, const std::string value = "");
+        // Decides the representation of fields left at INDEXED_HEADER_FIELD which
+        // miss the tables. nullptr restores the DefaultIndexingPolicy. The policy is
+        // not owned and must outlive the table.
+        void SetIndexingPolicy(IndexingPolicy* policy);
 
-        uint32_t dynamic_table_size_max_;
-        std::vector<HeaderField> dynamic_table_;
+        const Stats& GetStats() const;
+        void ResetStats();
+
+    private:
+        bool Append(HeaderField header);
+        DECODE_STATUS Scan(const char* buff, const uint32_t len, uint32_t offset);
+        DECODE_STATUS ScanString(const char* buff, const uint32_t len, uint32_t& offset, uint64_t& field_len);
+        bool EntryLength(uint32_t idx, uint32_t& name_len, uint32_t& value_len);
+        bool DecodeField(HeaderBlock& block, const char* buff, const uint32_t len, uint32_t& offset, bool copy, bool update_table);
+        bool LookupIndex(HeaderBlock& block, uint32_t idx, HeaderFieldView& field, bool with_value);
+        static bool DecodeString(HeaderBlock& block, const char* buff, const uint32_t len, uint32_t& offset, const char*& str, uint32_t& str_len, bool& use_huffman, bool copy);
+        // Static or dynamic table index of the best match for header, 0 if even the name is unknown.
+        uint32_t Find(const HeaderKey& key, bool& value_match);
+        void UpdateStats(const HeaderKey& key, uint32_t idx, bool indexed, bool inserted, uint32_t encoded_len);
+
+        DynamicTable dynamic_table_;
+        uint32_t table_size_limit_;
+        bool size_update_pending_ = false;      // encoder, a size update starts the next block
+        uint32_t size_update_min_ = 0;          // smallest size since the last block
+        DefaultIndexingPolicy default_policy_;
+        IndexingPolicy* policy_ = &default_policy_;
+        Stats stats_;
+
+        // State of the header block being decoded.
+        bool decoding_ = false;
+        DECODE_STATUS decode_status_ = DECODE_COMPLETE;
+        uint64_t header_list_size_ = 0;
+        uint32_t max_header_list_size_ = UINT32_MAX;
+        Buffer pending_;                // representation cut by the end of the last fragment
+        HeaderBlock scratch_;           // decode target of the list variants
     };
 }
 
@@ -1,6 +1,5 @@
-#include <queue>
-
 #include "huffman.h"
+#include "../buffer/byte_cursor.h"
 
 using namespace hpack;
 
@@ -9,7 +8,7 @@ struct HuffmanCode {
     uint8_t code_len;
 };
 
-static const struct HuffmanCode huffman_codes[HUFFMAN_CODE_SIZE] = {
+static constexpr struct HuffmanCode huffman_codes[HUFFMAN_CODE_SIZE] = {
     {0x1ff8, 13},     {0x7fffd8, 23},   {0xfffffe2, 28},  {0xfffffe3, 28},
     {0xfffffe4, 28},  {0xfffffe5, 28},  {0xfffffe6, 28},  {0xfffffe7, 28},
     {0xfffffe8, 28},  {0xffffea, 24},   {0x3ffffffc, 30}, {0xfffffe9, 28},
@@ -77,35 +76,128 @@ static const struct HuffmanCode huffman_codes[HUFFMAN_CODE_SIZE] = {
     {0x3fffffff, 30},
 };
 
-Huffman::Huffman() {
-    struct node* cur;
-    for(int i = 0; i < HUFFMAN_CODE_SIZE; i++) {
-        cur = &root_;
-        for(int j = huffman_codes[i].code_len - 1; j >= 0; j--) {
-            if(((huffman_codes[i].code >> j) & 1) == 1) {
-                if(cur->right == nullptr) cur->right = new struct node();
-                cur = cur->right;
-            } else {
-                if(cur->left == nullptr) cur->left = new struct node();
-                cur = cur->left;
-            }
+/*
+    Decoder tables, generated from huffman_codes by the compiler into read-only data.
+
+    The decode table is indexed by the next HUFFMAN_DECODE_BITS bits of input and
+    yields the one or two symbols whose codes fit into them. Most header text is
+    made of 5 to 8 bit codes, so a lookup mostly completes two symbols.
+
+    Longer codes, and the last few bits of a string, are resolved with the
+    canonical table. RFC 7541 codes are canonical: codes of one length are
+    consecutive in symbol order and the left aligned codes grow with their
+    length, so the length of the next code is the first one whose limit lies
+    above the input bits.
+*/
+struct HuffmanDecodeEntry {
+    uint8_t symbols[2] = {};
+    uint8_t count = 0;      // symbols completed, 0 if the first code is longer than HUFFMAN_DECODE_BITS
+    uint8_t len = 0;        // bits they take
+};
+
+struct HuffmanDecodeTable {
+    HuffmanDecodeEntry entries[1 << HUFFMAN_DECODE_BITS];
+};
+
+struct HuffmanCanonicalTable {
+    uint64_t limit[HUFFMAN_CODE_LEN_MAX + 1] = {};      // left aligned 32 bit code following the codes of a length
+    uint32_t first[HUFFMAN_CODE_LEN_MAX + 1] = {};      // first code of a length
+    uint16_t offset[HUFFMAN_CODE_LEN_MAX + 1] = {};     // position of that code in symbols
+    uint16_t symbols[HUFFMAN_CODE_SIZE] = {};           // in code order
+};
+
+struct HuffmanLengthTable {
+    uint8_t code_len[256] = {};
+};
+
+static constexpr HuffmanDecodeTable BuildDecodeTable() {
+    HuffmanDecodeTable table, single;
+    uint32_t i = 0, j = 0, len = 0, first = 0, rest = 0;
+
+    // The first symbol owns every index its code is a prefix of.
+    for(i = 0; i < HUFFMAN_CODE_SIZE; i++) {
+        len = huffman_codes[i].code_len;
+        if(len > HUFFMAN_DECODE_BITS) continue;
+
+        first = huffman_codes[i].code << (HUFFMAN_DECODE_BITS - len);
+        for(j = 0; j < (1u << (HUFFMAN_DECODE_BITS - len)); j++) {
+            HuffmanDecodeEntry& entry = table.entries[first + j];
+            entry.symbols[0] = i;
+            entry.count = 1;
+            entry.len = len;
         }
-        cur->value = i;
     }
+
+    // A second symbol is added when its code fits into the bits left.
+    single = table;
+    for(i = 0; i < (1u << HUFFMAN_DECODE_BITS); i++) {
+        HuffmanDecodeEntry& entry = table.entries[i];
+        if(entry.count == 0) continue;
+
+        rest = (i << entry.len) & ((1u << HUFFMAN_DECODE_BITS) - 1);
+        const HuffmanDecodeEntry& next = single.entries[rest];
+        if(next.count == 0 || entry.len + next.len > HUFFMAN_DECODE_BITS) continue;
+
+        entry.symbols[1] = next.symbols[0];
+        entry.count = 2;
+        entry.len = entry.len + next.len;
+    }
+
+    return table;
 }
 
-Huffman::~Huffman() {
-    std::queue<struct node*> s;
+static constexpr HuffmanCanonicalTable BuildCanonicalTable() {
+    HuffmanCanonicalTable table;
+    uint32_t i = 0, len = 0, n = 0;
+    uint64_t limit = 0;
 
-    if(root_.left != nullptr) s.push(root_.left);
-    if(root_.right != nullptr) s.push(root_.right);
+    for(len = 1; len <= HUFFMAN_CODE_LEN_MAX; len++) {
+        table.offset[len] = n;
+        for(i = 0; i < HUFFMAN_CODE_SIZE; i++) {
+            if(huffman_codes[i].code_len != len) continue;
 
-    while(!s.empty()) {
-        struct node* cur = s.front();
-        if(cur->left != nullptr) s.push(cur->left);
-        if(cur->right != nullptr) s.push(cur->right);
-        delete cur;
+            if(n == table.offset[len]) table.first[len] = huffman_codes[i].code;
+            table.symbols[n++] = i;
+            limit = (uint64_t)(huffman_codes[i].code + 1) << (32 - len);
+        }
+        table.limit[len] = limit;
+    }
+
+    return table;
+}
+
+static constexpr HuffmanLengthTable BuildLengthTable() {
+    HuffmanLengthTable table;
+    for(int i = 0; i < 256; i++) {
+        table.code_len[i] = huffman_codes[i].code_len;
+    }
+    return table;
+}
+
+static constexpr HuffmanDecodeTable decode_table = BuildDecodeTable();
+static constexpr HuffmanCanonicalTable canonical_table = BuildCanonicalTable();
+static constexpr HuffmanLengthTable length_table = BuildLengthTable();
+
+// Every code is found again through the canonical table, i.e. the code table is canonical.
+static constexpr bool CanonicalCodes() {
+    uint32_t i = 0, len = 0, window = 0;
+
+    for(i = 0; i < HUFFMAN_CODE_SIZE; i++) {
+        window = huffman_codes[i].code << (32 - huffman_codes[i].code_len);
+        for(len = HUFFMAN_CODE_LEN_MIN; window >= canonical_table.limit[len]; len++);
+
+        if(len != huffman_codes[i].code_len) return false;
+        if(canonical_table.symbols[canonical_table.offset[len] + (window >> (32 - len)) - canonical_table.first[len]] != i) return false;
     }
+    return true;
+}
+
+static_assert(CanonicalCodes(), "the canonical decode table does not match huffman_codes");
+
+Huffman::Huffman() {
+}
+
+Huffman::~Huffman() {
 }
 
 Huffman& Huffman::GetInstance() {
@@ -114,60 +206,157 @@ Huffman& Huffman::GetInstance() {
 }
 
 bool Huffman::Encode(Buffer& target, const Buffer& string) {
-    int i, append_remain = 8, cur_remain;
-    char cur_ch, append_ch = 0xFF;
-
-    target.Clear();
-
-    for(i = 0; i < string.Length(); i++) {
-        cur_ch = string.Get(i);
-        cur_remain = huffman_codes[cur_ch].code_len;
-        while(cur_remain > 0) {
-            if(cur_remain >= append_remain) {
-                append_ch = append_ch & (cur_ch >> (cur_remain - append_remain));
-                cur_remain = cur_remain - append_remain;
-                target.Append(append_ch);
-                append_remain = 8;
-                append_ch = 0xFF;
-            }
-            else {
-                append_ch = append_ch & (cur_ch << (append_remain - cur_remain));
-                cur_remain = 0;
-                append_remain = append_remain - cur_remain;
-            }
+    target.Resize(EncodedLength(string.Address(), string.Length()));
+    if(target.Length() > 0) Encode(&target[0], string.Address(), string.Length());
+    return true;
+}
+
+uint32_t Huffman::EncodedLength(const char* str, uint32_t str_len) {
+    const uint8_t* in = (const uint8_t *)str;
+    uint64_t bits0 = 0, bits1 = 0, bits2 = 0, bits3 = 0;
+    uint32_t i = 0;
+
+    // Four independent sums so the additions do not wait on each other.
+    for(; i + 4 <= str_len; i += 4) {
+        bits0 = bits0 + length_table.code_len[in[i]];
+        bits1 = bits1 + length_table.code_len[in[i + 1]];
+        bits2 = bits2 + length_table.code_len[in[i + 2]];
+        bits3 = bits3 + length_table.code_len[in[i + 3]];
+    }
+    for(; i < str_len; i++) {
+        bits0 = bits0 + length_table.code_len[in[i]];
+    }
+
+    return (bits0 + bits1 + bits2 + bits3 + 7) / 8;
+}
+
+uint32_t Huffman::Encode(char* target, const char* str, uint32_t str_len) {
+    const uint8_t* in = (const uint8_t *)str;
+    const uint8_t* end = in + str_len;
+    uint64_t acc = 0;
+    uint32_t bits = 0;
+    char* out = target;
+
+    // Fewer than 32 bits are pending before a code is added and codes are at
+    // most 30 bits long, so the accumulator never overflows.
+    for(; in < end; in++) {
+        const HuffmanCode& code = huffman_codes[*in];
+        acc = (acc << code.code_len) | code.code;
+        bits = bits + code.code_len;
+
+        if(bits >= 32) {
+            bits = bits - 32;
+            byte_order::Store<4>(out, acc >> bits);
+            out = out + 4;
         }
     }
 
-    return true;
+    while(bits >= 8) {
+        bits = bits - 8;
+        *out++ = (char)(acc >> bits);
+    }
+
+    // The last octet is padded with the most significant bits of EOS, i.e. ones.
+    if(bits > 0) {
+        *out++ = (char)((acc << (8 - bits)) | (0xff >> bits));
+    }
+
+    return out - target;
 }
 
 bool Huffman::Decode(Buffer& target, const Buffer& code) {
-    int i;
-    uint8_t mask;
-    struct node* cur = &root_;
-
-    target.Clear();
-
-    for(i = 0; i < code.Length(); i++) {
-        mask = 0x80;
-        while(mask > 0) {
-            if((code.Get(i) & mask) == mask) {
-                if(cur->right == nullptr) return false;
-                cur = cur->right;
+    uint32_t target_len = 0;
+
+    target.Resize(DecodedLengthMax(code.Length()));
+    if(target.Length() == 0) return true;
+
+    bool result = Decode(&target[0], target_len, code.Address(), code.Length());
+    target.Resize(target_len);
+    return result;
+}
+
+uint32_t Huffman::DecodedLengthMax(uint32_t code_len) {
+    // The shortest code is 5 bits long.
+    return (uint64_t)code_len * 8 / 5;
+}
+
+// Symbol of the code at the top of window and its length, a code of any length.
+static inline uint32_t DecodeCanonical(uint32_t window, uint32_t& len) {
+    for(len = HUFFMAN_CODE_LEN_MIN; window >= canonical_table.limit[len]; len++);
+    return canonical_table.symbols[canonical_table.offset[len] + (window >> (32 - len)) - canonical_table.first[len]];
+}
+
+bool Huffman::Decode(char* target, uint32_t& target_len, const char* code, uint32_t code_len) {
+    const char* in = code;
+    const char* end = code + code_len;
+    uint64_t acc = 0;       // input bits, the next one is the most significant
+    uint32_t bits = 0, len = 0, symbol;
+    char* out = target;
+
+    /*
+        While 8 octets are left the input is read a word at a time and decoded
+        as long as any code fits into the bits buffered. The input left also
+        leaves room for a second symbol in target, so both are stored and out
+        advances by the count. The word load leaves the bits of the following
+        partial octet in acc, the next load ORs in the same values.
+    */
+    while(end - in >= 8) {
+        acc = acc | (byte_order::Load<8>(in) >> bits);
+        in = in + ((63 - bits) >> 3);
+        bits = bits | 56;
+
+        do {
+            const HuffmanDecodeEntry& entry = decode_table.entries[acc >> (64 - HUFFMAN_DECODE_BITS)];
+            if(entry.count > 0) {
+                out[0] = entry.symbols[0];
+                out[1] = entry.symbols[1];
+                out = out + entry.count;
+                len = entry.len;
             }
             else {
-                if(cur->left == nullptr) return false;
-                cur = cur->left;
+                symbol = DecodeCanonical(acc >> 32, len);
+                if(symbol == HUFFMAN_EOS) return false;
+                *out++ = (char)symbol;
             }
 
-            if(cur->value != -1) {
-                if(cur->value == 256) return true;
-                target.Append(cur->value);
-                cur = &root_;
-            }
+            acc = acc << len;
+            bits = bits - len;
+        } while(bits >= HUFFMAN_CODE_LEN_MAX);
+    }
 
-            mask = mask >> 1;
+    // The last octets, until only padding is left.
+    for(;;) {
+        for(; bits <= 48 && in < end; in++) {
+            acc = acc | ((uint64_t)(uint8_t)*in << (56 - bits));
+            bits = bits + 8;
         }
+
+        if(bits >= HUFFMAN_DECODE_BITS) {
+            const HuffmanDecodeEntry& entry = decode_table.entries[acc >> (64 - HUFFMAN_DECODE_BITS)];
+            if(entry.count > 0) {
+                out[0] = entry.symbols[0];
+                if(entry.count > 1) out[1] = entry.symbols[1];
+                out = out + entry.count;
+                acc = acc << entry.len;
+                bits = bits - entry.len;
+                continue;
+            }
+        }
+
+        if(bits == 0) break;
+
+        // Missing bits read as ones, a code which needs them is padding.
+        symbol = DecodeCanonical((acc | (~0ULL >> bits)) >> 32, len);
+        if(len > bits) break;
+        if(symbol == HUFFMAN_EOS) return false;
+
+        *out++ = (char)symbol;
+        acc = acc << len;
+        bits = bits - len;
     }
-    return true;
-}
\ No newline at end of file
+
+    target_len = out - target;
+
+    // Padding is a prefix of EOS (all ones) of at most 7 bits (RFC 7541 5.2).
+    return bits == 0 || (bits < 8 && (acc >> (64 - bits)) == (1u << bits) - 1);
+}
@@ -3,30 +3,35 @@
 
 #include <stdint.h>
 
-#include "../buffer/Buffer.h"
+#include "../buffer/buffer.h"
 
 #define HUFFMAN_CODE_SIZE 257
+#define HUFFMAN_EOS 256
+#define HUFFMAN_CODE_LEN_MIN 5
+#define HUFFMAN_CODE_LEN_MAX 30
+#define HUFFMAN_DECODE_BITS 12          // input bits resolved by one decode table lookup
 
 namespace hpack {
     class Huffman {
     public:
         static Huffman& GetInstance();
         static bool Encode(Buffer& encoded_buffer, const Buffer& string);
+
+        // Writes exactly EncodedLength(str, str_len) bytes into target and returns that length.
+        static uint32_t Encode(char* target, const char* str, uint32_t str_len);
+        static uint32_t EncodedLength(const char* str, uint32_t str_len);
         static bool Decode(Buffer& decoded_buffer, const Buffer& code);
 
+        // Decodes into target, which must have room for DecodedLengthMax(code_len) bytes.
+        static bool Decode(char* target, uint32_t& target_len, const char* code, uint32_t code_len);
+        static uint32_t DecodedLengthMax(uint32_t code_len);
+
         Huffman(Huffman const&) = delete;
         void operator=(Huffman const&) = delete;
 
     private:
         Huffman();
         ~Huffman();
-
-        struct node {
-            struct node *left = nullptr, *right = nullptr;
-            int value = -1;
-        };
-        
-        static struct node root_;
     };
 }
 
@@ -0,0 +1,56 @@
+#include <cstring>
+
+#include "indexing_policy.h"
+
+using namespace hpack;
+
+// Cookies this short are easily guessed from the compressed length (RFC 7541 7.1.3).
+#define SHORT_COOKIE_LENGTH 20
+
+static bool NameIs(const HeaderKey& key, const char* name, uint32_t name_len) {
+    return key.name_len == name_len && memcmp(key.name, name, name_len) == 0;
+}
+
+IndexingPolicy::~IndexingPolicy() {
+}
+
+void IndexingPolicy::Observe(const HeaderKey& key) {
+}
+
+DefaultIndexingPolicy::DefaultIndexingPolicy() {
+    memset(sketch_, 0, sizeof(sketch_));
+}
+
+// Two counters per field taken from different bits of the hash, the smaller one
+// is the estimate (count-min sketch), so a single collision does not promote a field.
+static uint32_t Slot(uint32_t hash, int row) {
+    return (row == 0 ? hash : (hash >> 16) ^ (hash << 3)) & (INDEXING_POLICY_SKETCH_SIZE - 1);
+}
+
+void DefaultIndexingPolicy::Observe(const HeaderKey& key) {
+    for(int row = 0; row < 2; row++) {
+        uint8_t& count = sketch_[Slot(key.field_hash, row)];
+        if(count < UINT8_MAX) count++;
+    }
+
+    if(++observed_ >= INDEXING_POLICY_DECAY_PERIOD) {
+        for(int i = 0; i < INDEXING_POLICY_SKETCH_SIZE; i++) {
+            sketch_[i] = sketch_[i] / 2;
+        }
+        observed_ = 0;
+    }
+}
+
+IndexingPolicy::DECISION DefaultIndexingPolicy::Decide(const HeaderKey& key, const DynamicTable& table) {
+    uint64_t entry_size = (uint64_t)key.name_len + key.value_len + HEADER_ENTRY_OVERHEAD;
+    uint8_t count = sketch_[Slot(key.field_hash, 0)];
+    if(sketch_[Slot(key.field_hash, 1)] < count) count = sketch_[Slot(key.field_hash, 1)];
+
+    if(NameIs(key, "authorization", 13) || NameIs(key, "proxy-authorization", 19)) return NEVER_INDEX;
+    if(NameIs(key, "cookie", 6) && key.value_len < SHORT_COOKIE_LENGTH) return NEVER_INDEX;
+
+    if(entry_size > table.MaxSize() / 4) return DO_NOT_INDEX;
+
+    if(table.Size() + entry_size > table.MaxSize()) return count >= 3 ? INDEX : DO_NOT_INDEX;
+    return count >= 2 ? INDEX : DO_NOT_INDEX;
+}
@@ -0,0 +1,59 @@
+#ifndef _HPACK_INDEXING_POLICY_H_
+#define _HPACK_INDEXING_POLICY_H_
+
+#include <stdint.h>
+
+#include "dynamic_table.h"
+
+#define INDEXING_POLICY_SKETCH_SIZE 1024       // Repeat counters, must be a power of two
+#define INDEXING_POLICY_DECAY_PERIOD 4096      // Observations between two halvings of every counter
+
+namespace hpack {
+    /*
+        ### Indexing policy ###
+
+        Decides how the encoder represents a field which is not fully matched by
+        either table. Only fields whose type was left at INDEXED_HEADER_FIELD,
+        which asks the encoder to choose, go through the policy; an explicit
+        literal type set by the application is always honoured.
+
+        Observe() is called for every field of a header block which is actually
+        sent, before the field is looked up, so a policy can track what repeats.
+    */
+    class IndexingPolicy {
+    public:
+        typedef enum _DECISION {
+            INDEX = 0,          // Literal with incremental indexing
+            DO_NOT_INDEX,       // Literal without indexing
+            NEVER_INDEX,        // Literal never indexed, also by intermediaries
+        } DECISION;
+
+        virtual ~IndexingPolicy();
+
+        virtual void Observe(const HeaderKey& key);
+        virtual DECISION Decide(const HeaderKey& key, const DynamicTable& table) = 0;
+    };
+
+    /*
+        Default heuristic. Credentials are never indexed (RFC 7541 7.1.3). Entries
+        which would take more than a quarter of the table are not indexed, since
+        they flush the hot entries for a single use. Otherwise a field is indexed
+        from its second occurrence on, or from its third one when inserting it
+        has to evict something. Occurrences are counted in a small decaying
+        sketch keyed by the field hash, so one-off values such as request ids or
+        timestamps never make it into the table.
+    */
+    class DefaultIndexingPolicy : public IndexingPolicy {
+    public:
+        DefaultIndexingPolicy();
+
+        void Observe(const HeaderKey& key) override;
+        DECISION Decide(const HeaderKey& key, const DynamicTable& table) override;
+
+    private:
+        uint8_t sketch_[INDEXING_POLICY_SKETCH_SIZE];
+        uint32_t observed_ = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,311 @@
+#include <cstring>
+
+#include "static_table.h"
+
+using namespace hpack;
+
+#define STATIC_ENTRY(name, value) {name, sizeof(name) - 1, value, sizeof(value) - 1}
+
+static constexpr StaticEntry static_table[STATIC_TABLE_SIZE] = {
+    STATIC_ENTRY("", ""),                           // 0
+    STATIC_ENTRY(":authority", ""),                 // 1
+    STATIC_ENTRY(":method", "GET"),                 // 2
+    STATIC_ENTRY(":method", "POST"),                // 3
+    STATIC_ENTRY(":path", "/"),                     // 4
+    STATIC_ENTRY(":path", "/index.html"),           // 5
+    STATIC_ENTRY(":scheme", "http"),                // 6
+    STATIC_ENTRY(":scheme", "https"),               // 7
+    STATIC_ENTRY(":status", "200"),                 // 8
+    STATIC_ENTRY(":status", "204"),                 // 9
+    STATIC_ENTRY(":status", "206"),                 // 10
+    STATIC_ENTRY(":status", "304"),                 // 11
+    STATIC_ENTRY(":status", "400"),                 // 12
+    STATIC_ENTRY(":status", "404"),                 // 13
+    STATIC_ENTRY(":status", "500"),                 // 14
+    STATIC_ENTRY("accept-charset", ""),             // 15
+    STATIC_ENTRY("accept-encoding", "gzip, deflate"),// 16
+    STATIC_ENTRY("accept-language", ""),            // 17
+    STATIC_ENTRY("accept-ranges", ""),              // 18
+    STATIC_ENTRY("accept", ""),                     // 19
+    STATIC_ENTRY("access-control-allow-origin", ""),// 20
+    STATIC_ENTRY("age", ""),                        // 21
+    STATIC_ENTRY("allow", ""),                      // 22
+    STATIC_ENTRY("authorization", ""),              // 23
+    STATIC_ENTRY("cache-control", ""),              // 24
+    STATIC_ENTRY("content-disposition", ""),        // 25
+    STATIC_ENTRY("content-encoding", ""),           // 26
+    STATIC_ENTRY("content-language", ""),           // 27
+    STATIC_ENTRY("content-length", ""),             // 28
+    STATIC_ENTRY("content-location", ""),           // 29
+    STATIC_ENTRY("content-range", ""),              // 30
+    STATIC_ENTRY("content-type", ""),               // 31
+    STATIC_ENTRY("cookie", ""),                     // 32
+    STATIC_ENTRY("date", ""),                       // 33
+    STATIC_ENTRY("etag", ""),                       // 34
+    STATIC_ENTRY("expect", ""),                     // 35
+    STATIC_ENTRY("expires", ""),                    // 36
+    STATIC_ENTRY("from", ""),                       // 37
+    STATIC_ENTRY("host", ""),                       // 38
+    STATIC_ENTRY("if-match", ""),                   // 39
+    STATIC_ENTRY("if-modified-since", ""),          // 40
+    STATIC_ENTRY("if-none-match", ""),              // 41
+    STATIC_ENTRY("if-range", ""),                   // 42
+    STATIC_ENTRY("if-unmodified-since", ""),        // 43
+    STATIC_ENTRY("last-modified", ""),              // 44
+    STATIC_ENTRY("link", ""),                       // 45
+    STATIC_ENTRY("location", ""),                   // 46
+    STATIC_ENTRY("max-forwards", ""),               // 47
+    STATIC_ENTRY("proxy-authenticate", ""),         // 48
+    STATIC_ENTRY("proxy-authorization", ""),        // 49
+    STATIC_ENTRY("range", ""),                      // 50
+    STATIC_ENTRY("referer", ""),                    // 51
+    STATIC_ENTRY("refresh", ""),                    // 52
+    STATIC_ENTRY("retry-after", ""),                // 53
+    STATIC_ENTRY("server", ""),                     // 54
+    STATIC_ENTRY("set-cookie", ""),                 // 55
+    STATIC_ENTRY("strict-transport-security", ""),  // 56
+    STATIC_ENTRY("transfer-encoding", ""),          // 57
+    STATIC_ENTRY("user-agent", ""),                 // 58
+    STATIC_ENTRY("vary", ""),                       // 59
+    STATIC_ENTRY("via", ""),                        // 60
+    STATIC_ENTRY("www-authenticate", ""),           // 61
+};
+
+const StaticEntry& StaticTable::Get(uint32_t idx) {
+    return static_table[idx];
+}
+
+uint32_t StaticTable::FindName(const char* name, uint32_t name_len) {
+    if(name_len == 0) return 0;
+
+    switch(name_len) {
+        case 3:
+            switch(name[0]) {
+                case 'a':
+                    if(memcmp(name, "age", 3) == 0) return 21;
+                    break;
+                case 'v':
+                    if(memcmp(name, "via", 3) == 0) return 60;
+                    break;
+            }
+            break;
+        case 4:
+            switch(name[0]) {
+                case 'd':
+                    if(memcmp(name, "date", 4) == 0) return 33;
+                    break;
+                case 'e':
+                    if(memcmp(name, "etag", 4) == 0) return 34;
+                    break;
+                case 'f':
+                    if(memcmp(name, "from", 4) == 0) return 37;
+                    break;
+                case 'h':
+                    if(memcmp(name, "host", 4) == 0) return 38;
+                    break;
+                case 'l':
+                    if(memcmp(name, "link", 4) == 0) return 45;
+                    break;
+                case 'v':
+                    if(memcmp(name, "vary", 4) == 0) return 59;
+                    break;
+            }
+            break;
+        case 5:
+            switch(name[0]) {
+                case ':':
+                    if(memcmp(name, ":path", 5) == 0) return 4;
+                    break;
+                case 'a':
+                    if(memcmp(name, "allow", 5) == 0) return 22;
+                    break;
+                case 'r':
+                    if(memcmp(name, "range", 5) == 0) return 50;
+                    break;
+            }
+            break;
+        case 6:
+            switch(name[0]) {
+                case 'a':
+                    if(memcmp(name, "accept", 6) == 0) return 19;
+                    break;
+                case 'c':
+                    if(memcmp(name, "cookie", 6) == 0) return 32;
+                    break;
+                case 'e':
+                    if(memcmp(name, "expect", 6) == 0) return 35;
+                    break;
+                case 's':
+                    if(memcmp(name, "server", 6) == 0) return 54;
+                    break;
+            }
+            break;
+        case 7:
+            switch(name[0]) {
+                case ':':
+                    if(memcmp(name, ":method", 7) == 0) return 2;
+                    if(memcmp(name, ":scheme", 7) == 0) return 6;
+                    if(memcmp(name, ":status", 7) == 0) return 8;
+                    break;
+                case 'e':
+                    if(memcmp(name, "expires", 7) == 0) return 36;
+                    break;
+                case 'r':
+                    if(memcmp(name, "referer", 7) == 0) return 51;
+                    if(memcmp(name, "refresh", 7) == 0) return 52;
+                    break;
+            }
+            break;
+        case 8:
+            switch(name[0]) {
+                case 'i':
+                    if(memcmp(name, "if-match", 8) == 0) return 39;
+                    if(memcmp(name, "if-range", 8) == 0) return 42;
+                    break;
+                case 'l':
+                    if(memcmp(name, "location", 8) == 0) return 46;
+                    break;
+            }
+            break;
+        case 10:
+            switch(name[0]) {
+                case ':':
+                    if(memcmp(name, ":authority", 10) == 0) return 1;
+                    break;
+                case 's':
+                    if(memcmp(name, "set-cookie", 10) == 0) return 55;
+                    break;
+                case 'u':
+                    if(memcmp(name, "user-agent", 10) == 0) return 58;
+                    break;
+            }
+            break;
+        case 11:
+            switch(name[0]) {
+                case 'r':
+                    if(memcmp(name, "retry-after", 11) == 0) return 53;
+                    break;
+            }
+            break;
+        case 12:
+            switch(name[0]) {
+                case 'c':
+                    if(memcmp(name, "content-type", 12) == 0) return 31;
+                    break;
+                case 'm':
+                    if(memcmp(name, "max-forwards", 12) == 0) return 47;
+                    break;
+            }
+            break;
+        case 13:
+            switch(name[0]) {
+                case 'a':
+                    if(memcmp(name, "accept-ranges", 13) == 0) return 18;
+                    if(memcmp(name, "authorization", 13) == 0) return 23;
+                    break;
+                case 'c':
+                    if(memcmp(name, "cache-control", 13) == 0) return 24;
+                    if(memcmp(name, "content-range", 13) == 0) return 30;
+                    break;
+                case 'i':
+                    if(memcmp(name, "if-none-match", 13) == 0) return 41;
+                    break;
+                case 'l':
+                    if(memcmp(name, "last-modified", 13) == 0) return 44;
+                    break;
+            }
+            break;
+        case 14:
+            switch(name[0]) {
+                case 'a':
+                    if(memcmp(name, "accept-charset", 14) == 0) return 15;
+                    break;
+                case 'c':
+                    if(memcmp(name, "content-length", 14) == 0) return 28;
+                    break;
+            }
+            break;
+        case 15:
+            switch(name[0]) {
+                case 'a':
+                    if(memcmp(name, "accept-encoding", 15) == 0) return 16;
+                    if(memcmp(name, "accept-language", 15) == 0) return 17;
+                    break;
+            }
+            break;
+        case 16:
+            switch(name[0]) {
+                case 'c':
+                    if(memcmp(name, "content-encoding", 16) == 0) return 26;
+                    if(memcmp(name, "content-language", 16) == 0) return 27;
+                    if(memcmp(name, "content-location", 16) == 0) return 29;
+                    break;
+                case 'w':
+                    if(memcmp(name, "www-authenticate", 16) == 0) return 61;
+                    break;
+            }
+            break;
+        case 17:
+            switch(name[0]) {
+                case 'i':
+                    if(memcmp(name, "if-modified-since", 17) == 0) return 40;
+                    break;
+                case 't':
+                    if(memcmp(name, "transfer-encoding", 17) == 0) return 57;
+                    break;
+            }
+            break;
+        case 18:
+            switch(name[0]) {
+                case 'p':
+                    if(memcmp(name, "proxy-authenticate", 18) == 0) return 48;
+                    break;
+            }
+            break;
+        case 19:
+            switch(name[0]) {
+                case 'c':
+                    if(memcmp(name, "content-disposition", 19) == 0) return 25;
+                    break;
+                case 'i':
+                    if(memcmp(name, "if-unmodified-since", 19) == 0) return 43;
+                    break;
+                case 'p':
+                    if(memcmp(name, "proxy-authorization", 19) == 0) return 49;
+                    break;
+            }
+            break;
+        case 25:
+            switch(name[0]) {
+                case 's':
+                    if(memcmp(name, "strict-transport-security", 25) == 0) return 56;
+                    break;
+            }
+            break;
+        case 27:
+            switch(name[0]) {
+                case 'a':
+                    if(memcmp(name, "access-control-allow-origin", 27) == 0) return 20;
+                    break;
+            }
+            break;
+    }
+
+    return 0;
+}
+
+uint32_t StaticTable::Find(const HeaderKey& key, bool& value_match) {
+    uint32_t first = FindName(key.name, key.name_len), idx;
+
+    value_match = false;
+    if(first == 0) return 0;
+
+    for(idx = first; idx < STATIC_TABLE_SIZE && static_table[idx].name_len == key.name_len && memcmp(static_table[idx].name, key.name, key.name_len) == 0; idx++) {
+        if(static_table[idx].value_len == key.value_len && memcmp(static_table[idx].value, key.value, key.value_len) == 0) {
+            value_match = true;
+            return idx;
+        }
+    }
+
+    return first;
+}
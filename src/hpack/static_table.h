@@ -0,0 +1,40 @@
+#ifndef _HPACK_STATIC_TABLE_H_
+#define _HPACK_STATIC_TABLE_H_
+
+#include <stdint.h>
+
+#include "dynamic_table.h"
+
+#define STATIC_TABLE_SIZE 62
+
+namespace hpack {
+    struct StaticEntry {
+        const char* name;
+        uint32_t name_len;
+        const char* value;
+        uint32_t value_len;
+    };
+
+    /*
+        ### Static table ###
+
+        RFC 7541 Appendix A. The entries are compile time constants and names
+        are resolved by a switch on the length and the first character, so a
+        lookup costs at most a couple of short memcmp() calls and never
+        allocates. Entries sharing a name are adjacent in the table, so a
+        name/value lookup continues from the first entry with the name.
+    */
+    class StaticTable {
+    public:
+        // idx must be in 1 ... STATIC_TABLE_SIZE - 1.
+        static const StaticEntry& Get(uint32_t idx);
+
+        // Index of the first entry with the name, 0 if there is none.
+        static uint32_t FindName(const char* name, uint32_t name_len);
+
+        // Index of the entry matching name and value (value_match is set) or else the name only, 0 if there is none.
+        static uint32_t Find(const HeaderKey& key, bool& value_match);
+    };
+}
+
+#endif
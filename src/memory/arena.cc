@@ -0,0 +1,119 @@
+#include "arena.h"
+
+using namespace lhttp2;
+
+Arena::Arena(MemoryResource* upstream, size_t slab_size) : upstream_(upstream), slab_size_(slab_size) {
+    if(upstream_ == nullptr) upstream_ = NewDeleteResource();
+    if(slab_size_ < ARENA_SIZE_CLASS_MAX) slab_size_ = ARENA_SIZE_CLASS_MAX;
+}
+
+Arena::~Arena() {
+    Reset();
+}
+
+void Arena::Reset() {
+    for(size_t i = 0; i < slabs_.size(); i++) {
+        upstream_->Deallocate(slabs_[i], slab_size_);
+    }
+    slabs_.clear();
+
+    for(int i = 0; i < ARENA_SIZE_CLASS_COUNT; i++) {
+        classes_[i] = SizeClass();
+    }
+
+    in_use_ = 0;
+    bytes_in_use_ = 0;
+    bytes_reserved_ = 0;
+}
+
+void Arena::Release() {
+    released_ = true;
+    if(in_use_ == 0) delete this;
+}
+
+size_t Arena::InUse() const {
+    return in_use_;
+}
+
+size_t Arena::BytesInUse() const {
+    return bytes_in_use_;
+}
+
+size_t Arena::BytesReserved() const {
+    return bytes_reserved_;
+}
+
+MemoryResource* Arena::upstream() const {
+    return upstream_;
+}
+
+void* Arena::DoAllocate(size_t bytes, size_t alignment) {
+    int idx = GetSizeClass(bytes);
+
+    // Size classes are powers of two, so every object is aligned to its own size
+    // as long as it does not exceed the alignment of the slab itself.
+    // Large objects are counted as well, they keep a released arena alive just the same.
+    if(idx < 0 || alignment > alignof(std::max_align_t)) {
+        void* p = upstream_->Allocate(bytes, alignment);
+        if(p == nullptr) return nullptr;
+
+        in_use_++;
+        bytes_in_use_ = bytes_in_use_ + bytes;
+        return p;
+    }
+
+    size_t class_size = (size_t)16 << idx;
+    SizeClass& size_class = classes_[idx];
+    void* p;
+
+    if(size_class.free_list != nullptr) {
+        p = size_class.free_list;
+        size_class.free_list = size_class.free_list->next;
+    }
+    else {
+        if(size_class.cursor == nullptr || size_class.cursor + class_size > size_class.end) {
+            char* slab = (char *)upstream_->Allocate(slab_size_);
+            if(slab == nullptr) return nullptr;
+            slabs_.push_back(slab);
+            bytes_reserved_ = bytes_reserved_ + slab_size_;
+            size_class.cursor = slab;
+            size_class.end = slab + slab_size_;
+        }
+        p = size_class.cursor;
+        size_class.cursor = size_class.cursor + class_size;
+    }
+
+    in_use_++;
+    bytes_in_use_ = bytes_in_use_ + class_size;
+    return p;
+}
+
+void Arena::DoDeallocate(void* p, size_t bytes, size_t alignment) {
+    int idx = GetSizeClass(bytes);
+
+    if(idx < 0 || alignment > alignof(std::max_align_t)) {
+        upstream_->Deallocate(p, bytes, alignment);
+        bytes_in_use_ = bytes_in_use_ - bytes;
+    }
+    else {
+        struct FreeNode* node = (struct FreeNode *)p;
+        node->next = classes_[idx].free_list;
+        classes_[idx].free_list = node;
+        bytes_in_use_ = bytes_in_use_ - ((size_t)16 << idx);
+    }
+
+    in_use_--;
+    if(released_ && in_use_ == 0) delete this;
+}
+
+int Arena::GetSizeClass(size_t bytes) {
+    if(bytes > ARENA_SIZE_CLASS_MAX) return -1;
+
+    int idx = 0;
+    size_t class_size = 16;
+    while(class_size < bytes) {
+        class_size = class_size << 1;
+        idx++;
+    }
+    return idx;
+}
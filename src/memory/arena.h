@@ -0,0 +1,75 @@
+#ifndef _LHTTP2_ARENA_H_
+#define _LHTTP2_ARENA_H_
+
+#include <vector>
+
+#include "memory_resource.h"
+
+#define ARENA_SIZE_CLASS_COUNT 9        // 16, 32, 64, ..., 4096 bytes
+#define ARENA_SIZE_CLASS_MAX 4096
+#define ARENA_SLAB_SIZE (16 * 1024)
+
+namespace lhttp2 {
+    /*
+        ### Arena ###
+
+        Single threaded slab allocator meant to be owned by one connection.
+        Requests are rounded up to a power of two size class; every class carves
+        its objects out of its own slabs and recycles them through a free list.
+        Requests above ARENA_SIZE_CLASS_MAX go straight to the upstream resource.
+
+        Reset() hands every slab back to the upstream resource at once, so it
+        must only be called when nothing allocated from the arena is alive
+        (see InUse()).
+
+        An arena created with new whose allocations may outlive its owner is
+        given up with Release() instead of delete; it destroys itself once the
+        last of them is deallocated. Nothing is locked, every allocation and
+        deallocation must happen on the thread of the owner.
+    */
+    class Arena final : public MemoryResource {
+    public:
+        Arena(MemoryResource* upstream = NewDeleteResource(), size_t slab_size = ARENA_SLAB_SIZE);
+        ~Arena();
+
+        Arena(const Arena&) = delete;
+        void operator=(const Arena&) = delete;
+
+        void Reset();
+        void Release();
+
+        size_t InUse() const;
+        size_t BytesInUse() const;
+        size_t BytesReserved() const;
+        MemoryResource* upstream() const;
+
+    protected:
+        void* DoAllocate(size_t bytes, size_t alignment) override;
+        void DoDeallocate(void* p, size_t bytes, size_t alignment) override;
+
+    private:
+        struct FreeNode {
+            struct FreeNode* next;
+        };
+
+        struct SizeClass {
+            struct FreeNode* free_list = nullptr;
+            char* cursor = nullptr;
+            char* end = nullptr;
+        };
+
+        static int GetSizeClass(size_t bytes);
+
+        MemoryResource* upstream_;
+        size_t slab_size_;
+        SizeClass classes_[ARENA_SIZE_CLASS_COUNT];
+        std::vector<void*> slabs_;
+
+        bool released_ = false;
+        size_t in_use_ = 0;
+        size_t bytes_in_use_ = 0;
+        size_t bytes_reserved_ = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,47 @@
+#include <cstdlib>
+
+#include "memory_resource.h"
+
+using namespace lhttp2;
+
+namespace {
+    class NewDeleteMemoryResource final : public MemoryResource {
+    protected:
+        void* DoAllocate(size_t bytes, size_t alignment) override {
+            if(alignment <= alignof(std::max_align_t)) return malloc(bytes);
+
+            void* p = nullptr;
+            if(posix_memalign(&p, alignment, bytes) != 0) return nullptr;
+            return p;
+        }
+
+        void DoDeallocate(void* p, size_t bytes, size_t alignment) override {
+            free(p);
+        }
+    };
+}
+
+MemoryResource::~MemoryResource() {
+}
+
+void* MemoryResource::Allocate(size_t bytes, size_t alignment) {
+    return DoAllocate(bytes, alignment);
+}
+
+void MemoryResource::Deallocate(void* p, size_t bytes, size_t alignment) {
+    if(p == nullptr) return;
+    DoDeallocate(p, bytes, alignment);
+}
+
+bool MemoryResource::IsEqual(const MemoryResource& other) const {
+    return DoIsEqual(other);
+}
+
+bool MemoryResource::DoIsEqual(const MemoryResource& other) const {
+    return this == &other;
+}
+
+MemoryResource* lhttp2::NewDeleteResource() {
+    static NewDeleteMemoryResource instance;
+    return &instance;
+}
@@ -0,0 +1,79 @@
+#ifndef _LHTTP2_MEMORY_RESOURCE_H_
+#define _LHTTP2_MEMORY_RESOURCE_H_
+
+#include <cstddef>
+#include <new>
+
+namespace lhttp2 {
+    /*
+        ### Memory resource ###
+
+        Pluggable allocator interface shaped after std::pmr::memory_resource.
+        Frames, receive blocks and decoded header strings can be served from any
+        implementation (plain malloc, jemalloc, a per-connection Arena, ...).
+    */
+    class MemoryResource {
+    public:
+        virtual ~MemoryResource();
+
+        void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+        void Deallocate(void* p, size_t bytes, size_t alignment = alignof(std::max_align_t));
+        bool IsEqual(const MemoryResource& other) const;
+
+    protected:
+        virtual void* DoAllocate(size_t bytes, size_t alignment) = 0;
+        virtual void DoDeallocate(void* p, size_t bytes, size_t alignment) = 0;
+        virtual bool DoIsEqual(const MemoryResource& other) const;
+    };
+
+    // Resource backed by malloc/free, used when nothing else is configured.
+    MemoryResource* NewDeleteResource();
+
+    /*
+        ### Polymorphic allocator ###
+
+        Standard allocator adaptor over a MemoryResource, so containers such as
+        std::vector or std::basic_string can draw from the same resource.
+    */
+    template <typename T>
+    class PolymorphicAllocator {
+    public:
+        typedef T value_type;
+
+        PolymorphicAllocator() : resource_(NewDeleteResource()) {}
+        PolymorphicAllocator(MemoryResource* resource) : resource_(resource) {}
+
+        template <typename U>
+        PolymorphicAllocator(const PolymorphicAllocator<U>& other) : resource_(other.resource()) {}
+
+        // Containers expect std::bad_alloc rather than nullptr.
+        T* allocate(size_t n) {
+            T* p = (T *)resource_->Allocate(n * sizeof(T), alignof(T));
+            if(p == nullptr) throw std::bad_alloc();
+            return p;
+        }
+
+        void deallocate(T* p, size_t n) {
+            resource_->Deallocate(p, n * sizeof(T), alignof(T));
+        }
+
+        MemoryResource* resource() const {
+            return resource_;
+        }
+
+    private:
+        MemoryResource* resource_;
+    };
+
+    template <typename T, typename U>
+    bool operator==(const PolymorphicAllocator<T>& a, const PolymorphicAllocator<U>& b) {
+        return a.resource()->IsEqual(*b.resource());
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const PolymorphicAllocator<T>& a, const PolymorphicAllocator<U>& b) {
+        return !(a == b);
+    }
+}
+
+#endif
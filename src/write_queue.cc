@@ -0,0 +1,265 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "write_queue.h"
+
+using namespace lhttp2;
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Largest read of the copying fallback for files sendfile() does not take.
+#define WRITE_QUEUE_FILE_CHUNK 16384
+
+#ifndef MSG_MORE
+#define MSG_MORE 0
+#endif
+
+/*
+    sendfile() has no MSG_NOSIGNAL. SIGPIPE is blocked from the first file
+    segment of a Flush() until it returns, and a SIGPIPE a write to a closed
+    peer raised meanwhile is taken off the thread before it is unblocked.
+*/
+class PipeSignalBlock {
+public:
+    PipeSignalBlock() = default;
+    PipeSignalBlock(const PipeSignalBlock& a) = delete;
+    void operator=(const PipeSignalBlock& a) = delete;
+
+    ~PipeSignalBlock() {
+        struct timespec no_wait = {0, 0};
+        int err = errno;
+
+        if(blocked_ == false) return;
+
+        if(broken_pipe_ && was_pending_ == false) sigtimedwait(&pipe_set_, nullptr, &no_wait);
+        pthread_sigmask(SIG_SETMASK, &old_set_, nullptr);
+        errno = err;
+    }
+
+    void Block() {
+        sigset_t pending;
+
+        if(blocked_) return;
+
+        sigemptyset(&pipe_set_);
+        sigaddset(&pipe_set_, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipe_set_, &old_set_);
+
+        sigpending(&pending);
+        was_pending_ = sigismember(&pending, SIGPIPE);
+        blocked_ = true;
+    }
+
+    void BrokenPipe() {
+        broken_pipe_ = true;
+    }
+
+private:
+    sigset_t pipe_set_;
+    sigset_t old_set_;
+    bool blocked_ = false;
+    bool was_pending_ = false;
+    bool broken_pipe_ = false;
+};
+
+WriteQueue::WriteQueue(uint32_t flush_threshold, uint32_t limit) : flush_threshold_(flush_threshold), limit_(limit) {
+}
+
+bool WriteQueue::Push(BufferChain&& chain) {
+    if(Full() == true) return false;
+    if(chain.Length() == 0) return true;
+
+    queued_ = queued_ + chain.Length();
+    segments_.push_back({std::move(chain), {-1, 0, 0}});
+    return true;
+}
+
+bool WriteQueue::PushFile(const int file_fd, const off_t offset, const uint32_t len) {
+    if(Full() == true) return false;
+    if(len == 0) return true;
+
+    queued_ = queued_ + len;
+    segments_.push_back({BufferChain(), {file_fd, offset, len}});
+    return true;
+}
+
+bool WriteQueue::Full() const {
+    return Length() >= limit_;
+}
+
+bool WriteQueue::NeedsFlush() const {
+    return Length() >= flush_threshold_;
+}
+
+bool WriteQueue::Flush(const int fd) {
+    PipeSignalBlock pipe_signal;
+    ssize_t len;
+
+    while(head_ < segments_.size()) {
+        FileSegment& file = segments_[head_].file;
+
+        // Buffered bytes up to the next file segment go out together, a file segment on its own.
+        if(file.fd < 0) {
+            len = WriteChains(fd);
+        }
+        else {
+            pipe_signal.Block();
+            len = WriteFile(fd, file);
+        }
+
+        if(len < 0) {
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            if(errno == EPIPE) pipe_signal.BrokenPipe();
+            return false;
+        }
+
+        if(file.fd >= 0) {
+            // The file is shorter than announced, the frame can not be completed.
+            if(len == 0) return false;
+
+            file.len = file.len - len;
+            queued_ = queued_ - len;
+            if(file.len == 0) PopFront();
+        } else {
+            Consume(len);
+        }
+    }
+
+    return true;
+}
+
+uint32_t WriteQueue::Length() const {
+    return (queued_ < UINT32_MAX) ? (uint32_t)queued_ : UINT32_MAX;
+}
+
+bool WriteQueue::Empty() const {
+    return queued_ == 0;
+}
+
+void WriteQueue::SetLimits(uint32_t flush_threshold, uint32_t limit) {
+    flush_threshold_ = flush_threshold;
+    limit_ = limit;
+}
+
+void WriteQueue::Clear() {
+    segments_.clear();
+    head_ = 0;
+    sent_ = 0;
+    queued_ = 0;
+}
+
+// One write of the chain segments from the head up to the next file segment. A DATA frame
+// header in front of a file range is held back by the kernel until the file data joins it,
+// instead of going out as a packet of its own.
+ssize_t WriteQueue::WriteChains(const int fd) const {
+    struct iovec iov[WRITE_QUEUE_IOVEC_MAX];
+    struct msghdr msg = {};
+    uint32_t offset = sent_;
+    size_t i, cnt = 0;
+    int flags = MSG_NOSIGNAL;
+    ssize_t len;
+
+    for(i = head_; i < segments_.size() && segments_[i].file.fd < 0 && cnt < WRITE_QUEUE_IOVEC_MAX; i++) {
+        cnt = cnt + segments_[i].chain.FillIovec(iov + cnt, WRITE_QUEUE_IOVEC_MAX - cnt, offset);
+        offset = 0;
+    }
+
+    if(i < segments_.size() && segments_[i].file.fd >= 0) flags = flags | MSG_MORE;
+
+    msg.msg_iov = iov;
+    msg.msg_iovlen = cnt;
+
+    len = ::sendmsg(fd, &msg, flags);
+    if(len < 0 && errno == ENOTSOCK) len = ::writev(fd, iov, cnt);
+    return len;
+}
+
+// Drops the chain segments len written octets completed.
+void WriteQueue::Consume(uint64_t len) {
+    uint32_t left;
+
+    queued_ = queued_ - len;
+
+    while(len > 0) {
+        left = segments_[head_].chain.Length() - sent_;
+        if(len < left) {
+            sent_ = sent_ + len;
+            return;
+        }
+
+        len = len - left;
+        PopFront();
+    }
+}
+
+void WriteQueue::PopFront() {
+    // Buffers and blocks of the sent segment go back right away.
+    segments_[head_].chain.Clear();
+    head_++;
+    sent_ = 0;
+
+    // Slots are reused once the queue drains, or the sent half is dropped when it never does.
+    if(head_ == segments_.size()) {
+        segments_.clear();
+        head_ = 0;
+    } else if(head_ > segments_.size() / 2) {
+        segments_.erase(segments_.begin(), segments_.begin() + head_);
+        head_ = 0;
+    }
+}
+
+ssize_t WriteQueue::Write(const int fd, const BufferChain& chain, const uint32_t offset, const uint32_t end) {
+    struct iovec iov[WRITE_QUEUE_IOVEC_MAX];
+    struct msghdr msg = {};
+    uint32_t i, left = end - offset;
+    ssize_t len;
+
+    msg.msg_iov = iov;
+    msg.msg_iovlen = chain.FillIovec(iov, WRITE_QUEUE_IOVEC_MAX, offset);
+
+    // Nothing past end goes out.
+    for(i = 0; i < msg.msg_iovlen; i++) {
+        if(iov[i].iov_len >= left) {
+            iov[i].iov_len = left;
+            msg.msg_iovlen = i + 1;
+            break;
+        }
+        left = left - iov[i].iov_len;
+    }
+
+    len = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+
+    // Pipes and files can not take sendmsg(), they do not raise SIGPIPE on their own either.
+    if(len < 0 && errno == ENOTSOCK) len = ::writev(fd, iov, msg.msg_iovlen);
+    return len;
+}
+
+// One sendfile() of the segment, Flush() has SIGPIPE blocked.
+ssize_t WriteQueue::WriteFile(const int fd, FileSegment& file) {
+    char buff[WRITE_QUEUE_FILE_CHUNK];
+    ssize_t len, read_len;
+
+    len = ::sendfile(fd, file.fd, &file.offset, file.len);
+
+    // Files sendfile() can not map are read and sent in chunks.
+    if(len < 0 && (errno == EINVAL || errno == ENOSYS)) {
+        read_len = ::pread(file.fd, buff, (file.len < sizeof(buff)) ? file.len : sizeof(buff), file.offset);
+        len = read_len;
+        if(read_len > 0) {
+            len = ::send(fd, buff, read_len, MSG_NOSIGNAL);
+            if(len < 0 && errno == ENOTSOCK) len = ::write(fd, buff, read_len);
+            if(len > 0) file.offset = file.offset + len;
+        }
+    }
+
+    return len;
+}
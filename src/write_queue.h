@@ -0,0 +1,97 @@
+#ifndef _LHTTP2_WRITE_QUEUE_H_
+#define _LHTTP2_WRITE_QUEUE_H_
+
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "buffer/buffer_chain.h"
+
+#define WRITE_QUEUE_FLUSH_THRESHOLD 65536      // queued octets at which Push() asks for a flush
+#define WRITE_QUEUE_LIMIT (1 << 20)            // queued octets from which on Push() refuses frames
+#define WRITE_QUEUE_IOVEC_MAX 64               // iovecs handed to the kernel per call
+
+namespace lhttp2 {
+    /*
+        ### Write queue ###
+
+        Outbound bytes of a connection. Encoded frames are collected with Push()
+        and go out together, in as few sendmsg() calls as the socket allows, when
+        Flush() is called, typically once at the end of an event loop turn or as
+        soon as NeedsFlush() says that the threshold is reached.
+
+        The queue only references the chains it is given, which own or pin all
+        their bytes (see Frame::EncodeFrame()), so frames may be deleted right
+        after they are queued. Once the queue holds its limit, Full() is set and
+        Push() refuses further chains until Flush() got rid of some. Check Full()
+        before encoding a frame, a HEADERS frame which is encoded but never sent
+        leaves the peer's HPACK decoder behind.
+
+        Writes never raise SIGPIPE, a peer which went away is an error of Flush().
+
+        PushFile() queues a range of a file behind the bytes queued so far. It is
+        moved from the page cache to the socket with sendfile() when its turn
+        comes, and must stay open and unchanged until it has been flushed.
+
+        Every chain and file range is a segment of its own. A segment is dropped
+        as soon as its last octet is written, so Buffers and blocks go back to
+        their pools while the rest of the queue is still pending, and writes
+        start at the first unsent segment however long the queue has been busy.
+    */
+    class WriteQueue {
+    public:
+        WriteQueue(uint32_t flush_threshold = WRITE_QUEUE_FLUSH_THRESHOLD, uint32_t limit = WRITE_QUEUE_LIMIT);
+
+        WriteQueue(const WriteQueue& a) = delete;
+        void operator=(const WriteQueue& a) = delete;
+
+        bool Push(BufferChain&& chain);
+        bool PushFile(const int file_fd, const off_t offset, const uint32_t len);
+        bool Full() const;
+        bool NeedsFlush() const;
+
+        /*
+            Writes the queued bytes until everything is sent or a non-blocking
+            socket would block, the rest then stays queued for the next Flush().
+            Returns false on a write error.
+        */
+        bool Flush(const int fd);
+
+        // Octets queued and not written yet.
+        uint32_t Length() const;
+        bool Empty() const;
+
+        void SetLimits(uint32_t flush_threshold, uint32_t limit);
+        void Clear();
+
+        // One write of chain from offset up to end, like writev() but without SIGPIPE.
+        static ssize_t Write(const int fd, const BufferChain& chain, const uint32_t offset, const uint32_t end = UINT32_MAX);
+
+    private:
+        struct FileSegment {
+            int fd;                 // -1 for a segment of buffered bytes
+            off_t offset;           // next octet of the file to send
+            uint32_t len;           // octets left
+        };
+
+        struct Segment {
+            BufferChain chain;
+            FileSegment file;
+        };
+
+        ssize_t WriteChains(const int fd) const;
+        static ssize_t WriteFile(const int fd, FileSegment& file);
+        void Consume(uint64_t len);
+        void PopFront();
+
+        // Segments before head_ are sent, their slots are reused once the queue drains.
+        std::vector<Segment> segments_;
+        size_t head_ = 0;
+        uint32_t sent_ = 0;         // octets of the head segment's chain already written
+        uint64_t queued_ = 0;       // octets not written yet
+        uint32_t flush_threshold_;
+        uint32_t limit_;
+    };
+};
+
+#endif